@@ -0,0 +1,201 @@
+//Skewed read benchmark for BSTROOT's access modes against AVL
+//Builds each tree from the same random keys, then times the same Zipf distributed lookups on it and reports them as JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread ADAPTIVEBENCHMARK.cpp -o adaptivebenchmark
+//    ./adaptivebenchmark > adaptive.json
+//
+//Options:
+//    --size=1000000              Pairs in each tree, default is that
+//    --skews=0.8,0.99,1.1,1.2    Zipf exponents, one trace each. Higher is more skewed, default is those
+//    --reads=N                   Lookups per trace, default 5000000
+//    --sample=N                  sampled_splay splays one hit in N, default 8
+//    --seed=N                    Seed for keys and traces, default 12345
+//
+//Key of rank r is read with probability proportional to 1 / (r + 1)^skew. Ranks are dealt to keys at random,
+//so hot keys are spread over the tree and not tied to insertion order. top_percent_share is the part of the
+//trace that goes to the hottest 1% of keys, for 1000000 keys 0.99 gives about 66% and 1.1 about 80%.
+//Every lookup is a hit. The checksums of one trace must match across trees
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtoull and strtod
+#include <cstring> //For parsing options
+#include <cstdint> //For 8 byte keys
+#include <cmath> //For pow
+#include <vector> //For keys and traces
+#include <random> //For keys and traces
+#include <chrono> //For timing
+#include <algorithm> //For shuffling and upper_bound
+#include "AVL.h"
+#include "BSTROOT.h"
+
+typedef uint64_t key_type;
+typedef uint64_t value_type;
+
+//RUNNER
+
+struct options{
+    size_t size;
+    std::vector<double> skews;
+    size_t reads;
+    size_t sample;
+    unsigned long long seed;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+static void report(const char* name, double skew, double share, size_t ops, double seconds, int height, unsigned long long checksum){
+    printf("%s\n    {\"structure\": \"%s\", \"skew\": %.2f, \"top_percent_share\": %.3f, \"ops\": %zu, \"seconds\": %.4f, \"ns_per_op\": %.2f, \"height_after\": %d, \"checksum\": %llu}",
+           first_result ? "" : ",", name, skew, share, ops, seconds, ops ? seconds * 1e9 / ops : 0.0, height, checksum);
+    first_result = false;
+    fflush(stdout);
+}
+
+//Builds a fresh tree so one trace can't leave the next one a shape it made
+template<typename tree_type>
+static void run_tree(const char* name, tree_type& t, const std::vector<key_type>& keys, const std::vector<key_type>& trace, double skew, double share){
+    for(key_type k : keys){
+        t.insert(k, k);
+    }
+
+    unsigned long long checksum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(key_type k : trace){
+        checksum += *t.find(k);
+    }
+    double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    report(name, skew, share, trace.size(), seconds, t.height(), checksum);
+}
+
+static void run_skew(double skew, const std::vector<key_type>& keys, const std::vector<key_type>& by_rank, const options& opt){
+    using namespace cop3530;
+
+    //Cumulative weights of the ranks, a uniform number picks a rank by binary search
+    std::vector<double> cdf(by_rank.size());
+    double total = 0;
+    for(size_t r = 0; r < by_rank.size(); r++){
+        total += 1.0 / std::pow((double)(r + 1), skew);
+        cdf[r] = total;
+    }
+
+    std::mt19937_64 gen(opt.seed + (unsigned long long)(skew * 1000));
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    size_t hot = std::max<size_t>(1, by_rank.size() / 100);
+    size_t hot_reads = 0;
+
+    std::vector<key_type> trace(opt.reads);
+    for(size_t i = 0; i < opt.reads; i++){
+        size_t r = std::upper_bound(cdf.begin(), cdf.end(), uniform(gen)) - cdf.begin();
+        r = std::min(r, by_rank.size() - 1);
+        if(r < hot){
+            hot_reads++;
+        }
+        trace[i] = by_rank[r];
+    }
+    double share = opt.reads ? (double)hot_reads / opt.reads : 0.0;
+
+    {
+        basic_AVL<key_type, value_type> t;
+        run_tree("AVL", t, keys, trace, skew, share);
+    }
+    {
+        basic_BSTROOT<key_type, value_type> t;
+        run_tree("BSTROOT fixed", t, keys, trace, skew, share);
+    }
+    {
+        basic_BSTROOT<key_type, value_type> t;
+        t.adapt_on_access(access_mode::splay);
+        run_tree("BSTROOT splay", t, keys, trace, skew, share);
+    }
+    {
+        basic_BSTROOT<key_type, value_type> t;
+        t.adapt_on_access(access_mode::semi_splay);
+        run_tree("BSTROOT semi_splay", t, keys, trace, skew, share);
+    }
+    {
+        basic_BSTROOT<key_type, value_type> t;
+        t.adapt_on_access(access_mode::sampled_splay, opt.sample);
+        run_tree("BSTROOT sampled_splay", t, keys, trace, skew, share);
+    }
+}
+
+template<typename number>
+static std::vector<number> parse_list(const char* p){
+    std::vector<number> values;
+    while(*p){
+        char* end;
+        values.push_back((number)strtod(p, &end));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.size = 1000000;
+    opt.reads = 5000000;
+    opt.sample = 8;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--size=", 7) == 0){
+            opt.size = strtoull(arg + 7, nullptr, 10);
+        }
+        else if(strncmp(arg, "--skews=", 8) == 0){
+            opt.skews = parse_list<double>(arg + 8);
+        }
+        else if(strncmp(arg, "--reads=", 8) == 0){
+            opt.reads = strtoull(arg + 8, nullptr, 10);
+        }
+        else if(strncmp(arg, "--sample=", 9) == 0){
+            opt.sample = strtoull(arg + 9, nullptr, 10);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.skews.empty()){
+        opt.skews = {0.8, 0.99, 1.1, 1.2};
+    }
+    if(opt.size == 0 || opt.sample == 0){
+        fprintf(stderr, "Size and sample must be at least 1\n");
+        exit(1);
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    //Distinct random keys in random order, then an independent shuffle deals out the ranks
+    std::mt19937_64 gen(opt.seed);
+    std::vector<key_type> keys(opt.size);
+    for(size_t i = 0; i < opt.size; i++){
+        keys[i] = (gen() & 0xffffffff00000000ull) | i; //Low bits make every key distinct
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+    std::vector<key_type> by_rank = keys;
+    std::shuffle(by_rank.begin(), by_rank.end(), gen);
+
+    printf("{\n  \"config\": {\"size\": %zu, \"reads\": %zu, \"sample\": %zu, \"seed\": %llu},\n  \"results\": [", opt.size, opt.reads, opt.sample, opt.seed);
+
+    for(double skew : opt.skews){
+        run_skew(skew, keys, by_rank, opt);
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,202 @@
+//Window sums over a time series, aggregate against walking the window with an iterator
+//Builds an AVL keyed by timestamp with sum_augment, then times the same windows both ways and reports them as JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread AGGREGATEBENCHMARK.cpp -o aggregatebenchmark
+//    ./aggregatebenchmark > aggregate.json
+//
+//Options:
+//    --size=1000000              Samples in the series, default is that
+//    --windows=10,1000,10000     Samples in each window, default is those
+//    --queries=N                 Windows summed per width, default 20000
+//    --updates=N                 Counters bumped after the build, default 200000
+//    --seed=N                    Seed for samples and windows, default 12345
+//
+//Timestamps go up by 1 to 16 so windows are given in time, not in samples. scan walks from lower_bound to
+//the end of the window, so it costs the window's size. aggregate costs the tree's height whatever the window.
+//insert_ns_per_op compares building with and without the summaries. update_ns_per_op compares bumping counters
+//through lookup on the plain tree with update on the summed one, which also refreshes the summaries. The bumps
+//happen before any window is summed, so the checksums of one width must match
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtoull
+#include <cstring> //For parsing options
+#include <cstdint> //For 8 byte keys
+#include <vector> //For samples and windows
+#include <random> //For samples and windows
+#include <chrono> //For timing
+#include <utility> //For swapping samples
+#include "AVL.h"
+
+typedef uint64_t key_type;
+typedef uint64_t value_type;
+
+typedef cop3530::basic_AVL<key_type, value_type, cop3530::three_way_compare<key_type>, cop3530::heap_allocator, cop3530::no_stats, cop3530::avl_balance, cop3530::sum_augment<value_type>> summed_tree;
+typedef cop3530::basic_AVL<key_type, value_type> plain_tree;
+
+//RUNNER
+
+struct options{
+    size_t size;
+    std::vector<size_t> windows;
+    size_t queries;
+    size_t updates;
+    unsigned long long seed;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+static double seconds_since(bench_clock::time_point start){
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+static void report(const char* name, size_t window, size_t ops, double seconds, unsigned long long checksum){
+    printf("%s\n    {\"method\": \"%s\", \"window\": %zu, \"ops\": %zu, \"seconds\": %.4f, \"ns_per_op\": %.2f, \"checksum\": %llu}",
+           first_result ? "" : ",", name, window, ops, seconds, ops ? seconds * 1e9 / ops : 0.0, checksum);
+    first_result = false;
+    fflush(stdout);
+}
+
+template<typename tree_type>
+static double build(tree_type& t, const std::vector<key_type>& times, const std::vector<value_type>& counts){
+    bench_clock::time_point start = bench_clock::now();
+    for(size_t i = 0; i < times.size(); i++){
+        t.insert(times[i], counts[i]);
+    }
+    return seconds_since(start);
+}
+
+static std::vector<size_t> parse_list(const char* p){
+    std::vector<size_t> values;
+    while(*p){
+        char* end;
+        values.push_back((size_t)strtoull(p, &end, 10));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.size = 1000000;
+    opt.queries = 20000;
+    opt.updates = 200000;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--size=", 7) == 0){
+            opt.size = strtoull(arg + 7, nullptr, 10);
+        }
+        else if(strncmp(arg, "--windows=", 10) == 0){
+            opt.windows = parse_list(arg + 10);
+        }
+        else if(strncmp(arg, "--queries=", 10) == 0){
+            opt.queries = strtoull(arg + 10, nullptr, 10);
+        }
+        else if(strncmp(arg, "--updates=", 10) == 0){
+            opt.updates = strtoull(arg + 10, nullptr, 10);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.windows.empty()){
+        opt.windows = {10, 1000, 10000};
+    }
+    if(opt.size == 0){
+        fprintf(stderr, "Size must be at least 1\n");
+        exit(1);
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    //Samples arrive in random order, as counters from several sources would
+    std::mt19937_64 gen(opt.seed);
+    std::vector<key_type> times(opt.size);
+    std::vector<value_type> counts(opt.size);
+    key_type now = 0;
+    for(size_t i = 0; i < opt.size; i++){
+        now += 1 + gen() % 16;
+        times[i] = now;
+        counts[i] = gen() % 1000;
+    }
+    for(size_t i = opt.size - 1; i > 0; i--){
+        size_t j = gen() % (i + 1);
+        std::swap(times[i], times[j]);
+        std::swap(counts[i], counts[j]);
+    }
+
+    printf("{\n  \"config\": {\"size\": %zu, \"queries\": %zu, \"updates\": %zu, \"seed\": %llu},\n", opt.size, opt.queries, opt.updates, opt.seed);
+
+    plain_tree plain;
+    summed_tree summed;
+    double plain_seconds = build(plain, times, counts);
+    double summed_seconds = build(summed, times, counts);
+    printf("  \"insert_ns_per_op\": {\"plain\": %.2f, \"sum_augment\": %.2f},\n", plain_seconds * 1e9 / opt.size, summed_seconds * 1e9 / opt.size);
+
+    //Late samples add to counters already in the tree. Values in summed are const, so only update can change them
+    std::vector<size_t> bumped(opt.updates);
+    for(size_t i = 0; i < opt.updates; i++){
+        bumped[i] = gen() % opt.size;
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+    for(size_t i : bumped){
+        plain.lookup(times[i]) += counts[i];
+    }
+    plain_seconds = seconds_since(start);
+
+    start = bench_clock::now();
+    for(size_t i : bumped){
+        value_type more = counts[i];
+        summed.update(times[i], [more](value_type& v){ v += more; });
+    }
+    summed_seconds = seconds_since(start);
+
+    printf("  \"update_ns_per_op\": {\"plain\": %.2f, \"sum_augment\": %.2f},\n  \"results\": [",
+           opt.updates ? plain_seconds * 1e9 / opt.updates : 0.0, opt.updates ? summed_seconds * 1e9 / opt.updates : 0.0);
+
+    for(size_t window : opt.windows){
+        //Average gap is 8.5, so a window this long in time holds about window samples
+        key_type span = (key_type)(window * 8.5);
+        std::vector<key_type> starts(opt.queries);
+        for(size_t i = 0; i < opt.queries; i++){
+            starts[i] = gen() % (now + 1);
+        }
+
+        unsigned long long checksum = 0;
+        start = bench_clock::now();
+        for(key_type lo : starts){
+            for(plain_tree::iterator it = plain.lower_bound(lo); it != plain.end() && it->key <= lo + span; ++it){
+                checksum += it->value;
+            }
+        }
+        report("scan", window, opt.queries, seconds_since(start), checksum);
+
+        checksum = 0;
+        start = bench_clock::now();
+        for(key_type lo : starts){
+            checksum += summed.aggregate(lo, lo + span);
+        }
+        report("aggregate", window, opt.queries, seconds_since(start), checksum);
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
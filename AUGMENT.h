@@ -0,0 +1,153 @@
+#ifndef AUGMENT_H_INCLUDED
+#define AUGMENT_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <limits> //For min and max identities
+#include <type_traits> //For leaving out empty summaries
+
+namespace cop3530{
+
+    //Augment policies used by AVL. Every node keeps a summary of its whole subtree, which aggregate(lo, hi)
+    //puts together from O(log n) nodes instead of visiting every pair in the range. A policy gives:
+    //    summary_type                          what is kept per node
+    //    identity()                            summary of no pairs, combine(identity(), s) == s
+    //    of(key, value)                        summary of one pair
+    //    combine(a, b)                         summary of a's pairs followed by b's, must be associative
+    //combine is always called with the smaller keys on the left, so it doesn't have to be commutative
+
+    //Default policy, summaries are empty and take no room in a node
+    struct no_augment{
+        static const bool enabled = false; //Tree skips every summary update
+
+        struct summary_type{};
+
+        static summary_type identity();
+        template<typename key_type, typename value_type> static summary_type of(const key_type& k, const value_type& v);
+        static summary_type combine(const summary_type& a, const summary_type& b);
+    };
+
+    //Sum of the values, value_type needs + and a zero from value_type()
+    template<typename value_type>
+    struct sum_augment{
+        static const bool enabled = true;
+
+        typedef value_type summary_type;
+
+        static summary_type identity();
+        template<typename key_type> static summary_type of(const key_type& k, const value_type& v);
+        static summary_type combine(const summary_type& a, const summary_type& b);
+    };
+
+    //Smallest value, identity is the largest value_type there is
+    template<typename value_type>
+    struct min_augment{
+        static const bool enabled = true;
+
+        typedef value_type summary_type;
+
+        static summary_type identity();
+        template<typename key_type> static summary_type of(const key_type& k, const value_type& v);
+        static summary_type combine(const summary_type& a, const summary_type& b);
+    };
+
+    //Largest value, identity is the lowest value_type there is
+    template<typename value_type>
+    struct max_augment{
+        static const bool enabled = true;
+
+        typedef value_type summary_type;
+
+        static summary_type identity();
+        template<typename key_type> static summary_type of(const key_type& k, const value_type& v);
+        static summary_type combine(const summary_type& a, const summary_type& b);
+    };
+
+    //Where a node keeps its summary. Empty summaries are a base with nothing in it, so they cost no bytes
+    template<typename summary_type, bool stored = !std::is_empty<summary_type>::value>
+    struct summary_slot{
+        summary_type summary; //Summary of the subtree rooted at this node
+    };
+
+    template<typename summary_type>
+    struct summary_slot<summary_type, false>{};
+
+    //NO AUGMENT
+
+    inline no_augment::summary_type no_augment :: identity(){
+        return summary_type();
+    }
+
+    template<typename key_type, typename value_type>
+    no_augment::summary_type no_augment :: of(const key_type&, const value_type&){
+        return summary_type();
+    }
+
+    inline no_augment::summary_type no_augment :: combine(const summary_type&, const summary_type&){
+        return summary_type();
+    }
+
+    //SUM AUGMENT
+
+    template<typename value_type>
+    typename sum_augment<value_type>::summary_type sum_augment<value_type> :: identity(){
+        return value_type();
+    }
+
+    template<typename value_type>
+    template<typename key_type>
+    typename sum_augment<value_type>::summary_type sum_augment<value_type> :: of(const key_type&, const value_type& v){
+        return v;
+    }
+
+    template<typename value_type>
+    typename sum_augment<value_type>::summary_type sum_augment<value_type> :: combine(const summary_type& a, const summary_type& b){
+        return a + b;
+    }
+
+    //MIN AUGMENT
+
+    template<typename value_type>
+    typename min_augment<value_type>::summary_type min_augment<value_type> :: identity(){
+        return std::numeric_limits<value_type>::max();
+    }
+
+    template<typename value_type>
+    template<typename key_type>
+    typename min_augment<value_type>::summary_type min_augment<value_type> :: of(const key_type&, const value_type& v){
+        return v;
+    }
+
+    template<typename value_type>
+    typename min_augment<value_type>::summary_type min_augment<value_type> :: combine(const summary_type& a, const summary_type& b){
+        if(b < a){
+            return b;
+        }
+
+        return a;
+    }
+
+    //MAX AUGMENT
+
+    template<typename value_type>
+    typename max_augment<value_type>::summary_type max_augment<value_type> :: identity(){
+        return std::numeric_limits<value_type>::lowest();
+    }
+
+    template<typename value_type>
+    template<typename key_type>
+    typename max_augment<value_type>::summary_type max_augment<value_type> :: of(const key_type&, const value_type& v){
+        return v;
+    }
+
+    template<typename value_type>
+    typename max_augment<value_type>::summary_type max_augment<value_type> :: combine(const summary_type& a, const summary_type& b){
+        if(a < b){
+            return b;
+        }
+
+        return a;
+    }
+
+}
+
+#endif
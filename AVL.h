@@ -3,72 +3,278 @@
 
 #include <iostream> //For size_t and other things
 #include <stdexcept> //For exceptions
+#include <vector> //For iterator paths
+#include <utility> //For std::forward, std::move and std::swap
+#include <type_traits> //For checking how a value can be assigned, and making values const under an augment policy
+#include <future> //For running halves of set operations in parallel
+#include <thread> //For hardware_concurrency
+#include "NODEPOOL.h" //For node allocators
+#include "COMPARATOR.h" //For key comparators
+#include "STATS.h" //For operation counters
+#include "BALANCE.h" //For balancing policies
+#include "AUGMENT.h" //For range aggregates
+#include "SHAPE.h" //For shape reports
+#include "FROZEN.h" //For read-only snapshots
+#include "SNAPSHOT.h" //For saving to and loading from files
 
 namespace cop3530{
 
     //AVL tree, must be AVL balanced throughout
     //Only change is in insert and remove, must choose correct rotation for balance factor
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    class AVL{
+    //balance_policy picks the rotations, see BALANCE.h. wavl_balance trades a little height for fewer rotations on remove
+    template<typename key_type, typename value_type, typename comparator = three_way_compare<key_type>, template<typename> class allocator = heap_allocator, typename stats_policy = no_stats, typename balance_policy = avl_balance, typename augment_policy = no_augment>
+    class basic_AVL{
 
     private:
 
-        struct node{
+        //Subtree summary for aggregate sits in the base, no_augment leaves it empty
+        struct node : summary_slot<typename augment_policy::summary_type>{
             key_type key;
             value_type value;
             node* left;
             node* right;
+            int rank; //Kept by balance_policy, a leaf is 1. With avl_balance it is the cached height of the subtree rooted here
+            size_t count; //Number of nodes in the subtree rooted here
+
+            //Builds key and value in place from the insert arguments, new node is always a leaf
+            template<typename key_arg, typename... value_args>
+            node(key_arg&& k, value_args&&... args) : key(std::forward<key_arg>(k)), value(std::forward<value_args>(args)...), left(nullptr), right(nullptr), rank(1), count(1) {}
         };
 
         node* root;
-        size_t get_size(node* curr); //Function to recursively get amount of key-value pairs
-        node* do_delete(node*& curr, key_type k); //Removes node using recursion to fix tree
+        allocator<node> alloc; //Hands out and takes back every node in the tree
+        stats_policy counters; //Told about every comparison, rotation, lookup step, allocation and free, no_stats ignores them
+        friend balance_policy; //Rebalances through the rank, balance and rotation helpers below
+        template<typename key_like> int compare_keys(const key_like& a, const key_type& b); //One three-way comparison, negative if a < b, 0 if equal
+        size_t get_size(node* curr); //Returns cached size of a subtree, 0 for nullptr
+        node* do_delete(node*& curr, const key_type& k); //Removes node using recursion to fix tree
         void deletion(node* curr); //Helps the clear function. Deletes recursively
-        int get_height(node* curr); //Helps height function, recursively calls for height on nodes
+        int get_rank(node* curr); //Returns rank of a subtree's root, 0 for nullptr
+        void update_node(node* curr); //Recomputes cached size of a node from its children, and its rank if the rank is the height
+        void reset_rank(node* curr); //Sets a node's rank to one more than its higher child's and refreshes its size, for nodes placed over two subtrees
+        typename augment_policy::summary_type get_summary(node* curr); //Returns summary of a subtree, identity for nullptr
+        void refresh_summary(node* curr); //Recomputes a node's summary from its pair and its children's, does nothing under no_augment
+        size_t count_less(const key_type& k, bool inclusive); //Counts keys smaller than (or equal to, if inclusive) k
         node* rotate_left(node* curr); //Used during insertion at root, rotates subtree counterclockwise
         node* rotate_right(node* curr); //Used during insertion at root, rotates subtree clockwise
-        node* insert_at_leaf(node*& curr, key_type k, value_type v); //Called if insertion is for a leaf
+        template<typename key_arg, typename... value_args> node* insert_at_leaf(node*& curr, key_arg&& k, bool assign, bool& inserted, value_args&&... args); //Called if insertion is for a leaf
         int get_balance(node* curr); //Returns the balance factor for a subtree
-        void recursive_copy(node*& curr);
+        node* recursive_copy(const node* curr); //Used for deep copy, clones a subtree node by node keeping its shape
+        template<typename pair_iterator> node* build_balanced(pair_iterator& curr, size_t n); //Builds a balanced subtree from the next n sorted pairs
+        template<typename key_arg, typename... value_args> bool put(key_arg&& k, bool assign, value_args&&... args); //Single descent insert shared by the public inserts
+        template<typename value_arg> static void assign_value(value_type& target, value_arg&& v); //Overwrites a value from a single insert argument
+        template<typename... value_args> static void assign_value(value_type& target, value_args&&... args); //Overwrites a value built from several insert arguments
+        template<typename key_like> node* find_node(const key_like& k); //Returns node holding key, nullptr if missing
+        template<typename function> bool update_at(node* curr, const key_type& k, function& f); //Calls f on k's value in the subtree and refreshes summaries on the way back up, false if k is missing
+        static const size_t batch_lanes = 16; //Descents the batch lookups keep going at once
+        static void prefetch(const void* p); //Hint to start loading a cache line, does nothing where the builtin isn't there
+        template<typename visit> void find_nodes(const key_type* keys, size_t n, visit found); //Interleaved descents, calls found(i, node) for every key, node is nullptr if missing
+
+        //Join and split work on detached subtrees and only relink nodes, nothing is allocated or freed
+        static const size_t parallel_grain = 8192; //Set operations on fewer nodes than this stay on one thread
+        typedef node* (basic_AVL::*set_operation)(node* a, node* b, size_t workers, std::vector<node*>& garbage);
+        node* join_right(node* l, node* mid, node* r); //Join for when l is taller, hangs mid and r off l's right spine
+        node* join_left(node* l, node* mid, node* r); //Join for when r is taller, hangs l and mid off r's left spine
+        node* join_nodes(node* l, node* mid, node* r); //Keys in l < mid < keys in r, returns one balanced subtree of all three
+        node* join_pair(node* l, node* r); //Same without a middle node, l's largest node is taken out to be it
+        node* remove_max(node* curr, node*& max); //Unlinks largest node of a subtree into max, returns what is left
+        node* split_node(node* curr, const key_type& k, node*& less, node*& greater); //Splits subtree around k, returns node holding k or nullptr
+        void run_halves(set_operation op, node* a_left, node* b_left, node* a_right, node* b_right, node*& left, node*& right, size_t workers, std::vector<node*>& garbage); //Runs op on both halves, forking one if they are big enough
+        node* union_nodes(node* a, node* b, size_t workers, std::vector<node*>& garbage); //Keys in either, b's value wins on a tie
+        node* intersection_nodes(node* a, node* b, size_t workers, std::vector<node*>& garbage); //Keys in both, a's value is kept
+        node* difference_nodes(node* a, node* b, size_t workers, std::vector<node*>& garbage); //Keys in a but not b
+        void free_garbage(std::vector<node*>& garbage); //Frees subtrees set operations threw away, on this thread since allocators aren't shared
+        size_t worker_count(); //Threads a set operation may use
 
     public:
-        AVL();
-        AVL(const AVL& b); //copy constructor
-        AVL& operator=(const AVL& b); //Copy assignment operator
-        AVL(AVL&& b); //Move constructor
-        AVL& operator=(AVL&& b); //Move-assignment operator
-        ~AVL();
-
-        void insert(key_type k, value_type v); //Adds k-v pair to map
-        void remove(key_type k); //Removes k-v pair from map
-        value_type& lookup(key_type k); //Returns a reference to the value associated with given key
-
-        bool contains(key_type k); //Returns true if tree contains value associated with key
+        //Value as lookups and iterators hand it out. Const while summaries are kept, so a change can't leave them stale, update changes it then
+        typedef typename std::conditional<augment_policy::enabled, const value_type, value_type>::type exposed_value;
+
+        //Key-value pair handed out by iterators, key is const so tree order can't be broken
+        struct entry{
+            const key_type& key;
+            exposed_value& value;
+        };
+
+        //Bidirectional in-order iterator. Keeps the path from root to its node instead of parent pointers,
+        //so ++ and -- are amortized O(1). Any insert or remove invalidates every iterator
+        class iterator{
+
+        private:
+            friend class basic_AVL;
+
+            //Lets it->key and it->value work even though entries are made on the fly
+            struct arrow{
+                entry e;
+                entry* operator->(){ return &e; }
+            };
+
+            node* root; //Needed so --end() can find the largest key
+            std::vector<node*> path; //Root to current node, empty means end()
+
+            iterator(node* r) : root(r) {}
+
+            //Pushes curr and then keeps going to one side until the bottom
+            void push_leftmost(node* curr){
+                while(curr){
+                    path.push_back(curr);
+                    curr = curr->left;
+                }
+            }
+
+            void push_rightmost(node* curr){
+                while(curr){
+                    path.push_back(curr);
+                    curr = curr->right;
+                }
+            }
+
+        public:
+            iterator() : root(nullptr) {}
+
+            entry operator*() const{ return entry{path.back()->key, path.back()->value}; }
+            arrow operator->() const{ return arrow{**this}; }
+
+            iterator& operator++(){
+                node* curr = path.back();
+
+                //Next key is smallest one in right subtree
+                if(curr->right){
+                    push_leftmost(curr->right);
+                    return *this;
+                }
+
+                //Otherwise climb until we come up from a left child, that parent is next
+                path.pop_back();
+                while(!path.empty() && path.back()->right == curr){
+                    curr = path.back();
+                    path.pop_back();
+                }
+                return *this;
+            }
+
+            iterator& operator--(){
+                //Stepping back from end() lands on the largest key
+                if(path.empty()){
+                    push_rightmost(root);
+                    return *this;
+                }
+
+                node* curr = path.back();
+
+                //Previous key is largest one in left subtree
+                if(curr->left){
+                    push_rightmost(curr->left);
+                    return *this;
+                }
+
+                //Otherwise climb until we come up from a right child, that parent is previous
+                path.pop_back();
+                while(!path.empty() && path.back()->left == curr){
+                    curr = path.back();
+                    path.pop_back();
+                }
+                return *this;
+            }
+
+            iterator operator++(int){ iterator temp = *this; ++*this; return temp; }
+            iterator operator--(int){ iterator temp = *this; --*this; return temp; }
+
+            bool operator==(const iterator& b) const{
+                //Both at end, or both on the same node
+                if(path.empty() || b.path.empty()){
+                    return path.empty() && b.path.empty();
+                }
+                return path.back() == b.path.back();
+            }
+
+            bool operator!=(const iterator& b) const{ return !(*this == b); }
+        };
+
+        basic_AVL();
+        basic_AVL(const basic_AVL& b); //copy constructor
+        basic_AVL& operator=(const basic_AVL& b); //Copy assignment operator
+        basic_AVL(basic_AVL&& b); //Move constructor
+        basic_AVL& operator=(basic_AVL&& b); //Move-assignment operator
+        ~basic_AVL();
+
+        void insert(const key_type& k, const value_type& v); //Adds k-v pair to map
+        bool try_insert(const key_type& k, const value_type& v); //Adds k-v pair if key is new, returns true if it was added
+        bool insert_or_assign(const key_type& k, const value_type& v); //Adds k-v pair or overwrites existing value, returns true if it was added
+        void insert(key_type&& k, value_type&& v); //Same as above, but key and value are moved into the node
+        bool try_insert(key_type&& k, value_type&& v);
+        bool insert_or_assign(key_type&& k, value_type&& v);
+        template<typename... value_args> bool emplace(const key_type& k, value_args&&... args); //Builds value in place from args if key is new, returns true if it was added
+        template<typename... value_args> bool emplace(key_type&& k, value_args&&... args);
+        void remove(const key_type& k); //Removes k-v pair from map
+        exposed_value& lookup(const key_type& k); //Returns a reference to the value associated with given key
+        exposed_value* find(const key_type& k); //Returns a pointer to the value associated with given key, nullptr if missing
+        value_type lookup_or(const key_type& k, const value_type& fallback); //Returns the value associated with given key, fallback if missing
+        template<typename function> void update(const key_type& k, function f); //Calls f on the value for k, then refreshes the summaries above it
+
+        //Lookups by any type the comparator can compare against a key, only there if comparator has is_transparent
+        template<typename key_like, typename key_comparator = comparator, typename transparent = typename key_comparator::is_transparent> exposed_value& lookup(const key_like& k);
+        template<typename key_like, typename key_comparator = comparator, typename transparent = typename key_comparator::is_transparent> exposed_value* find(const key_like& k);
+        template<typename key_like, typename key_comparator = comparator, typename transparent = typename key_comparator::is_transparent> bool contains(const key_like& k);
+
+        bool contains(const key_type& k); //Returns true if tree contains value associated with key
+        void lookup_batch(const key_type* keys, size_t n, exposed_value** out); //Points out[i] at the value for keys[i], nullptr if missing. Walks several keys at once so their cache misses overlap
+        void contains_batch(const key_type* keys, size_t n, bool* out); //Sets out[i] to whether keys[i] is in the map, same walk as lookup_batch
         bool is_empty(); //Returns true if tree is empty
         bool is_full(); //Returns true if no more pairs can be added to map
         size_t size(); //Returns all key value pairs in map
         void clear(); //Removes all elements from map
-        int height(); //Returns tree's height
-        int balance(); //Returns tree's balance factor
+        int height(); //Returns tree's height, O(n) under a policy whose ranks aren't heights
+        int balance(); //Returns tree's balance factor, O(n) under a policy whose ranks aren't heights
+        tree_shape<key_type> shape_report(size_t worst = 8); //Depth histograms, path lengths and the worst most imbalanced subtrees, in one pass
+        tree_stats stats(); //Returns the counters so far, all 0 unless stats_policy is count_stats
+        void reset_stats(); //Sets every counter back to 0
+
+        const key_type& select(size_t i); //Returns the i-th smallest key, starting from 0
+        size_t rank(const key_type& k); //Returns how many keys are smaller than k
+        size_t count_in_range(const key_type& lo, const key_type& hi); //Returns how many keys are in [lo, hi]
+        typename augment_policy::summary_type aggregate(const key_type& lo, const key_type& hi); //Combines the summaries of every pair in [lo, hi] in key order. O(log n), needs an augment_policy
+
+        template<typename pair_iterator> void build_from_sorted(pair_iterator first, pair_iterator last); //Replaces map with sorted (key, value) pairs in linear time
+        basic_FROZEN<key_type, value_type, comparator> freeze(); //Copies every pair into a read-only map laid out for fast lookups, later changes here don't show up in it
+        void save(const std::string& path); //Writes every pair to a snapshot file, keys and values must be trivially copyable
+        void load(const std::string& path); //Replaces map with the pairs of a snapshot file in linear time, nothing changes if the file is bad
+
+        //Bulk operations, each one takes every node of b (b ends up empty) and relinks them instead of reinserting
+        void join(const key_type& k, const value_type& v, basic_AVL&& b); //Appends k-v and then b, every key here < k < every key in b. O(log n)
+        void join(basic_AVL&& b); //Appends b, every key here < every key in b. O(log n)
+        basic_AVL split(const key_type& k); //Keeps keys less than k, returns a tree with the rest. O(log n), under pool_allocator the two trees share an arena
+        void set_union(basic_AVL&& b); //Adds every pair of b, b's value wins if both have a key. O(m log(n/m + 1)) for m <= n
+        void set_intersection(basic_AVL&& b); //Keeps only keys b also has, values here are kept
+        void set_difference(basic_AVL&& b); //Removes every key b has
+
+        iterator begin(); //Iterator to smallest key
+        iterator end(); //Iterator past the largest key
+        iterator lower_bound(const key_type& k); //Iterator to first key not less than k
+        iterator upper_bound(const key_type& k); //Iterator to first key greater than k
+        iterator floor(const key_type& k); //Iterator to largest key not greater than k, end() if none
+        iterator ceiling(const key_type& k); //Iterator to smallest key not less than k, end() if none
     };
 
+    //Original interface, ordering comes from a pair of compare and equals functions
+    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type), template<typename> class allocator = heap_allocator, typename stats_policy = no_stats, typename balance_policy = avl_balance, typename augment_policy = no_augment>
+    using AVL = basic_AVL<key_type, value_type, function_compare<key_type, compare, equals>, allocator, stats_policy, balance_policy, augment_policy>;
+
     //CONSTRUCTORS AND DESTRUCTORS
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    AVL<key_type, value_type, compare, equals> :: AVL(){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: basic_AVL(){
         root = nullptr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    AVL<key_type, value_type, compare, equals> :: AVL(const AVL& b){ //Deep copy constructor
-        root = nullptr;
-
-        node* curr = b.root;
-        recursive_copy(curr);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: basic_AVL(const basic_AVL& b){ //Deep copy constructor
+        //Clone nodes directly instead of reinserting, so shape and cached fields carry over
+        root = recursive_copy(b.root);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    AVL<key_type, value_type, compare, equals>& AVL<key_type, value_type, compare, equals> :: operator=(const AVL& b){ //Copy assignment operator
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy>& basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: operator=(const basic_AVL& b){ //Copy assignment operator
         //Check that this and given BST arent the same
         if(this == &b){
             return *this;
@@ -76,21 +282,20 @@ namespace cop3530{
 
         //Else, clear the tree and add a deep copy of given BST
         clear();
-
-        node* curr = b.root;
-        recursive_copy(curr);
+        root = recursive_copy(b.root);
         return *this;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    AVL<key_type, value_type, compare, equals> :: AVL(AVL&& b){ //Move constructor
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: basic_AVL(basic_AVL&& b){ //Move constructor
         //Creates a shallow copy and sets root of given BST to nullptr
         root = b.root;
         b.root = nullptr;
+        alloc.swap(b.alloc); //Nodes stay in the pool they came from, so the pool moves with them
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    AVL<key_type, value_type, compare, equals>& AVL<key_type, value_type, compare, equals> :: operator=(AVL&& b){ //Move assignment operator
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy>& basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: operator=(basic_AVL&& b){ //Move assignment operator
         //Check that this and given BST arent the same
         if(this == &b){
             return *this;
@@ -100,117 +305,186 @@ namespace cop3530{
         clear();
         root = b.root;
         b.root = nullptr;
+        alloc.swap(b.alloc); //Nodes stay in the pool they came from, so the pool moves with them
         return *this;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    AVL<key_type, value_type, compare, equals> :: ~AVL(){
-        //To destroy BST, clear it and get rid of root
-        deletion(root);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: ~basic_AVL(){
+        //To destroy BST, free every node unless the allocator can drop them all at once
+        //A pool shared with a split half has to get every slot back, so the other half can use it again
+        if(!allocator<node>::bulk_release || alloc.shared()){
+            deletion(root);
+        }
     }
 
     //HELPER FUNCTIONS
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void AVL<key_type, value_type, compare, equals> :: recursive_copy(node*& curr){
-        if(curr){
-            insert(curr->key, curr->value);
-        }
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename key_like>
+    int basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: compare_keys(const key_like& a, const key_type& b){
+        //Comparator is stateless, so a temporary is free and the call can be inlined
+        counters.compared();
+        return comparator()(a, b);
+    }
 
-        if(curr->left){
-            recursive_copy(curr->left);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: recursive_copy(const node* curr){
+        //Copies node as is (key, value and cached fields), then replaces children with their copies
+        if(!curr){
+            return nullptr;
         }
-        if(curr->right){
-            recursive_copy(curr->right);
+
+        node* copy = alloc.allocate(*curr);
+        counters.allocated();
+        copy->left = recursive_copy(curr->left);
+        copy->right = recursive_copy(curr->right);
+        return copy;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename pair_iterator>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: build_balanced(pair_iterator& curr, size_t n){
+        //Left half, then middle pair, then right half, so pairs are consumed in order
+        //Halves differ in size by at most 1, which keeps the subtree perfectly balanced
+        if(n == 0){
+            return nullptr;
         }
+
+        node* left = build_balanced(curr, n / 2);
+
+        node* middle = alloc.allocate(curr->first, curr->second);
+        counters.allocated();
+        ++curr;
+
+        middle->left = left;
+        middle->right = build_balanced(curr, n - n / 2 - 1);
+        reset_rank(middle);
+        return middle;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    size_t AVL<key_type, value_type, compare, equals> :: get_size(node* curr){
-        //Recursively goes through counting number of nodes
-        //Case if node we are on doesn't exist
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    size_t basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: get_size(node* curr){
+        //Sizes are cached in each node, so this is constant time
         if(!curr){
             return 0;
         }
-        //Case where we reached bottom of tree, count 1
-        if(!curr->left && !curr->right){
-            return 1;
-        }
-        //Return left side + right + 1 to account for itself
-        return get_size(curr->left) + get_size(curr->right) + 1;
+
+        return curr->count;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    int AVL<key_type, value_type, compare, equals> :: get_balance(node* curr){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    int basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: get_balance(node* curr){
         //If curr exists, then get balance factor for given node
         if(curr){
-            return get_height(curr->left) - get_height(curr->right);
+            return get_rank(curr->left) - get_rank(curr->right);
         }
-    }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    int AVL<key_type, value_type, compare, equals> :: get_height(node* curr){
-        //Gets max height of left and right size, returns max
-        int left_max = 1;
-        int right_max = 1;
+        return 0;
+    }
 
-        //Case we are on node that does not exist
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    int basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: get_rank(node* curr){
+        //Ranks are cached in each node, so this is constant time
         if(!curr){
             return 0;
         }
-        //Bottom of tree, add 1 and work our way up
-        if(!curr->left && !curr->right){
-            return 1;
+
+        return curr->rank;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: update_node(node* curr){
+        //Size is both children plus itself, and so is the summary. Under avl_balance rank is the height,
+        //one more than the taller child, other policies move ranks themselves. Children must already be up to date
+        if(balance_policy::rank_is_height){
+            reset_rank(curr);
+            return;
         }
 
-        //Keep adding to specific side and work recursively
-        left_max += get_height(curr->left);
-        right_max += get_height(curr->right);
+        curr->count = get_size(curr->left) + get_size(curr->right) + 1;
+        refresh_summary(curr);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: reset_rank(node* curr){
+        //One more than the higher child is a valid rank for every policy, as long as the children's ranks are within 1
+        curr->count = get_size(curr->left) + get_size(curr->right) + 1;
+        refresh_summary(curr);
+
+        int left_rank = get_rank(curr->left);
+        int right_rank = get_rank(curr->right);
 
-        //Return the side with most items
-        if(left_max > right_max){
-            return left_max;
+        if(left_rank > right_rank){
+            curr->rank = left_rank + 1;
         }
+        else{
+            curr->rank = right_rank + 1;
+        }
+    }
 
-        return right_max;
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename augment_policy::summary_type basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: get_summary(node* curr){
+        //Summaries are cached in each node, so this is constant time
+        if constexpr(augment_policy::enabled){
+            if(curr){
+                return curr->summary;
+            }
+        }
+
+        return augment_policy::identity();
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void AVL<key_type, value_type, compare, equals> :: deletion(node* curr){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: refresh_summary(node* curr){
+        //Left subtree, then the node's own pair, then right subtree, so the summary is in key order
+        if constexpr(augment_policy::enabled){
+            curr->summary = augment_policy::combine(augment_policy::combine(get_summary(curr->left), augment_policy::of(curr->key, curr->value)), get_summary(curr->right));
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: deletion(node* curr){
         //Deletion goes to bottom of tree and works its way up, deleting each node on the way and setting children to nullptr
         if(curr){
             deletion(curr->left);
             deletion(curr->right);
-            delete curr;
+            alloc.deallocate(curr);
+            counters.freed();
         }
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    typename AVL<key_type, value_type, compare, equals> :: node* AVL<key_type, value_type, compare, equals> :: do_delete(node*& curr, key_type k){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: do_delete(node*& curr, const key_type& k){
         //Removing, this means we have a match and curr is on node we have to remove
 
         if(!curr){
             return curr;
         }
 
-        if(equals(k, curr->key)){
+        int order = compare_keys(k, curr->key); //One comparison picks the branch
+
+        if(order == 0){
             //Case 1: no children, just delete curr and set to nullptr for parent
             if(!curr->left && !curr->right){
                 node* temp = curr;
                 curr = nullptr;
-                delete temp;
+                alloc.deallocate(temp);
+                counters.freed();
             }
             //Case 2: One child. Simply delete and return right child so parent has that child
             else if(!curr->left){
                 node* temp = curr->right;
-                *curr = *temp;
-                delete temp;
+                *curr = std::move(*temp); //Child is freed next, so take its contents
+                alloc.deallocate(temp);
+                counters.freed();
             }
             //Case 2 but for other child
             else if(!curr->right){
                 node* temp = curr->left;
-                *curr = *temp;
-                delete temp;
+                *curr = std::move(*temp); //Child is freed next, so take its contents
+                alloc.deallocate(temp);
+                counters.freed();
             }
             //Case 3: 2 children from deletion node
             else{
@@ -220,16 +494,17 @@ namespace cop3530{
                     temp = temp->left;
                 }
 
-                //Swap in order successor's values with deletion node's
-                curr->key = temp->key;
-                curr->value = temp->value;
+                //Swap in order successor's values with deletion node's, swapping means nothing is copied
+                std::swap(curr->key, temp->key);
+                std::swap(curr->value, temp->value);
 
-                //Keep working in order to fix tree
+                //Keep working in order to fix tree, successor now holds the removed key
+                //It is still the smallest key on the right, so the descent finds it. k isn't read after that node is gone
                 curr->right = do_delete(curr->right, temp->key);
             }
         }
         //Key comes before node we are currently on, so go left
-        else if(compare(k, curr->key)){
+        else if(order < 0){
             curr->left = do_delete(curr->left, k);
         }
         //Key greater than, go right
@@ -242,157 +517,419 @@ namespace cop3530{
             return curr;
         }
 
-        int bf = get_balance(curr); //Gets the balance factor for this node
-
-        //These if statements check if bf is not in range of -1<bf<1. Does corresponding rotation if not in range
-        //This is similar to how insertion was done, just this time look at one child's bf and do corresponding rotation
-        //Left left rotation (left heavy)
-        if(bf > 1 && get_balance(curr->left) >= 0){
-            return rotate_right(curr);
-        }
-
-        //Left right rotation
-        if(bf > 1 && get_balance(curr->left) < 0){
-            curr->left = rotate_left(curr->left);
-            return rotate_right(curr);
-        }
-
-        //Right right rotation (right heavy)
-        if(bf < -1 && get_balance(curr->right) <= 0){
-            return rotate_left(curr);
-        }
-
-        //Right left rotation
-        if(bf < -1 && get_balance(curr->left) > 0){
-            curr->right = rotate_right(curr->right);
-            return rotate_left(curr);
-        }
-
-        //Return node to keep track of children
-        return curr;
+        //Children may have changed, refresh and let the policy fix this level
+        update_node(curr);
+        return balance_policy::shrank(*this, curr);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    typename AVL<key_type, value_type, compare, equals> :: node* AVL<key_type, value_type, compare, equals> :: rotate_left(node* curr){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: rotate_left(node* curr){
         //Rotate's counter clockwise and returns the new root of the (sub)tree
         node* temp = curr;
         curr = curr->right;
         temp->right = curr->left;
         curr->left = temp;
+
+        //Old root is now the child, so its height and size must be fixed first
+        update_node(temp);
+        update_node(curr);
         return curr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    typename AVL<key_type, value_type, compare, equals> :: node* AVL<key_type, value_type, compare, equals> :: rotate_right(node* curr){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: rotate_right(node* curr){
         //Rotate's clockwise and returns the new root of the (sub)tree
         node* temp = curr;
         curr = curr->left;
         temp->left = curr->right;
         curr->right = temp;
+
+        //Old root is now the child, so its height and size must be fixed first
+        update_node(temp);
+        update_node(curr);
         return curr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    typename AVL<key_type, value_type, compare, equals> :: node* AVL<key_type, value_type, compare, equals> :: insert_at_leaf(node*& curr, key_type k, value_type v){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename key_arg, typename... value_args>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: insert_at_leaf(node*& curr, key_arg&& k, bool assign, bool& inserted, value_args&&... args){
         //Since we are inserting at leaf, only insert when curr is nullptr
         if(!curr){
-            curr = new node;
-            curr->key = k;
-            curr->value = v;
-            curr->left = nullptr;
-            curr->right = nullptr;
+            curr = alloc.allocate(std::forward<key_arg>(k), std::forward<value_args>(args)...); //Key and value are built right in the node
+            counters.allocated();
+            refresh_summary(curr);
+            inserted = true;
+            return curr;
+        }
+
+        int order = compare_keys(k, curr->key); //One comparison picks the branch
+
+        //Key already in map, overwrite only if asked to and leave tree shape alone
+        if(order == 0){
+            if(assign){
+                assign_value(curr->value, std::forward<value_args>(args)...);
+                refresh_summary(curr);
+            }
             return curr;
         }
 
         //Key is less than current node, go left
-        if(compare(k, curr->key)){
-            curr->left = insert_at_leaf(curr->left, k, v);
+        if(order < 0){
+            curr->left = insert_at_leaf(curr->left, std::forward<key_arg>(k), assign, inserted, std::forward<value_args>(args)...);
         }
         //Go right
         else{
-            curr->right = insert_at_leaf(curr->right, k, v);
+            curr->right = insert_at_leaf(curr->right, std::forward<key_arg>(k), assign, inserted, std::forward<value_args>(args)...);
+        }
+
+        //Nothing was added below, so heights and sizes are unchanged. An overwritten value still changes the summaries above it
+        if(!inserted){
+            if(assign){
+                refresh_summary(curr);
+            }
+            return curr;
+        }
+
+        //Subtree grew by a node, refresh and let the policy fix this level
+        update_node(curr);
+        return balance_policy::grew(*this, curr);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    size_t basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: count_less(const key_type& k, bool inclusive){
+        //Walks down once, adding the left subtree and node itself every time we go right
+        size_t total = 0;
+        node* curr = root;
+
+        while(curr){
+            int order = compare_keys(k, curr->key); //One comparison picks the branch
+            if(order == 0){
+                //Everything in left subtree is smaller, node itself counts only if inclusive
+                total += get_size(curr->left);
+                if(inclusive){
+                    total++;
+                }
+                return total;
+            }
+            else if(order < 0){
+                curr = curr->left;
+            }
+            else{
+                total += get_size(curr->left) + 1;
+                curr = curr->right;
+            }
         }
 
-        int bf = get_balance(curr); //Gets the balance factor for this node
+        return total;
+    }
 
-        //These if statements check if bf is not in range of -1<bf<1. Does corresponding rotation if not in range
-        //Left left rotation (left heavy)
-        if(bf > 1 && compare(k, curr->left->key)){
-            return rotate_right(curr);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: join_right(node* l, node* mid, node* r){
+        //Walk down l's right spine until a subtree is no more than one taller than r, mid becomes its parent there
+        if(get_rank(l) <= get_rank(r) + 1){
+            mid->left = l;
+            mid->right = r;
+            reset_rank(mid);
+            return mid;
         }
 
-        //Left right rotation
-        if(bf > 1 && compare(curr->left->key, k)){
-            curr->left = rotate_left(curr->left);
-            return rotate_right(curr);
+        //Only this spine grew, so fixing balance on the way back up is enough
+        l->right = join_right(l->right, mid, r);
+        update_node(l);
+        return balance_policy::grew(*this, l);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: join_left(node* l, node* mid, node* r){
+        //Mirror of join_right, walks down r's left spine
+        if(get_rank(r) <= get_rank(l) + 1){
+            mid->left = l;
+            mid->right = r;
+            reset_rank(mid);
+            return mid;
         }
 
-        //Right right rotation (right heavy)
-        if(bf < -1 && compare(curr->right->key, k)){
-            return rotate_left(curr);
+        r->left = join_left(l, mid, r->left);
+        update_node(r);
+        return balance_policy::grew(*this, r);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: join_nodes(node* l, node* mid, node* r){
+        //Cost is the difference in heights, so joining a small tree onto a big one is cheap
+        if(get_rank(l) > get_rank(r) + 1){
+            return join_right(l, mid, r);
         }
 
-        //Right left rotation
-        if(bf < -1 && compare(k, curr->right->key)){
-            curr->right = rotate_right(curr->right);
-            return rotate_left(curr);
+        if(get_rank(r) > get_rank(l) + 1){
+            return join_left(l, mid, r);
         }
 
-        //Return child, with no changes made (keep going down)
-        return curr;
+        //Heights are close enough for mid to be the root
+        mid->left = l;
+        mid->right = r;
+        reset_rank(mid);
+        return mid;
     }
 
-    //PUBLIC FUNCTIONS
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: join_pair(node* l, node* r){
+        //Either side empty, nothing to join
+        if(!l){
+            return r;
+        }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void AVL<key_type, value_type, compare, equals> :: insert(key_type k, value_type v){
-        //If tree empty, just insert at root, otherwise check if key already used and recursively insert k-v pair
-        if(is_empty()){
-            root = new node;
-            root->key = k;
-            root->value = v;
-            root->left = nullptr;
-            root->right = nullptr;
+        if(!r){
+            return l;
+        }
+
+        node* max;
+        l = remove_max(l, max);
+        return join_nodes(l, max, r);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: remove_max(node* curr, node*& max){
+        //Largest node has no right child, its left subtree takes its place
+        if(!curr->right){
+            max = curr;
+            node* temp = curr->left;
+            curr->left = nullptr;
+            return temp;
+        }
+
+        curr->right = remove_max(curr->right, max);
+        update_node(curr);
+        return balance_policy::shrank(*this, curr);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: split_node(node* curr, const key_type& k, node*& less, node*& greater){
+        //Empty subtree splits into two empty ones
+        if(!curr){
+            less = nullptr;
+            greater = nullptr;
+            return nullptr;
+        }
+
+        int order = compare_keys(k, curr->key); //One comparison picks the branch
+
+        //Children are already the two halves, node holding k is handed back on its own
+        if(order == 0){
+            less = curr->left;
+            greater = curr->right;
+            curr->left = nullptr;
+            curr->right = nullptr;
+            reset_rank(curr);
+            return curr;
+        }
+
+        node* found;
+
+        //k is on the left, so this node and its right subtree all go to greater
+        if(order < 0){
+            node* right = curr->right;
+            found = split_node(curr->left, k, less, greater);
+            greater = join_nodes(greater, curr, right);
+        }
+        //k is on the right, so this node and its left subtree all go to less
+        else{
+            node* left = curr->left;
+            found = split_node(curr->right, k, less, greater);
+            less = join_nodes(left, curr, less);
+        }
+
+        return found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: run_halves(set_operation op, node* a_left, node* b_left, node* a_right, node* b_right, node*& left, node*& right, size_t workers, std::vector<node*>& garbage){
+        //Halves share no nodes, so they can run at the same time. Small ones aren't worth a thread
+        size_t total = get_size(a_left) + get_size(b_left) + get_size(a_right) + get_size(b_right);
+        if(workers < 2 || total < parallel_grain){
+            left = (this->*op)(a_left, b_left, 1, garbage);
+            right = (this->*op)(a_right, b_right, 1, garbage);
             return;
         }
 
-        if(contains(k)){
-            throw std::runtime_error("Already contain that key");
+        //Left half gets its own thread and garbage list, workers are split between the halves
+        std::vector<node*> left_garbage;
+        std::future<node*> pending = std::async(std::launch::async, [&]{ return (this->*op)(a_left, b_left, workers / 2, left_garbage); });
+        right = (this->*op)(a_right, b_right, workers - workers / 2, garbage);
+        left = pending.get();
+        garbage.insert(garbage.end(), left_garbage.begin(), left_garbage.end());
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: union_nodes(node* a, node* b, size_t workers, std::vector<node*>& garbage){
+        //One side empty, the other is the answer as is
+        if(!a){
+            return b;
+        }
+
+        if(!b){
+            return a;
         }
 
-        insert_at_leaf(root, k, v);
+        //Split b around a's root, then each side of a only has to meet the matching side of b
+        node* less;
+        node* greater;
+        node* found = split_node(b, a->key, less, greater);
+        node* a_left = a->left;
+        node* a_right = a->right;
+
+        //Both have the key, b's value moves in and its node is thrown away
+        if(found){
+            std::swap(a->value, found->value);
+            garbage.push_back(found);
+        }
+
+        node* left;
+        node* right;
+        run_halves(&basic_AVL::union_nodes, a_left, less, a_right, greater, left, right, workers, garbage);
+        return join_nodes(left, a, right);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void AVL<key_type, value_type, compare, equals> :: remove(key_type k){
-        //Check if empty to avoid errors, then call recursive function to remove
-        if(is_empty()){
-            throw std::runtime_error("Cannot remove from an empty map");
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: intersection_nodes(node* a, node* b, size_t workers, std::vector<node*>& garbage){
+        //One side empty, nothing is in both, so the other side is thrown away whole
+        if(!a || !b){
+            if(a){
+                garbage.push_back(a);
+            }
+            if(b){
+                garbage.push_back(b);
+            }
+            return nullptr;
         }
 
-        if(!contains(k)){
-            throw std::runtime_error("Key is not in map");
+        node* less;
+        node* greater;
+        node* found = split_node(b, a->key, less, greater);
+        node* a_left = a->left;
+        node* a_right = a->right;
+
+        node* left;
+        node* right;
+        run_halves(&basic_AVL::intersection_nodes, a_left, less, a_right, greater, left, right, workers, garbage);
+
+        //Both have a's root key, it stays and b's copy goes
+        if(found){
+            garbage.push_back(found);
+            return join_nodes(left, a, right);
         }
 
-        do_delete(root, k);
+        //Only a has it, so it goes too
+        a->left = nullptr;
+        a->right = nullptr;
+        garbage.push_back(a);
+        return join_pair(left, right);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    value_type& AVL<key_type, value_type, compare, equals> :: lookup(key_type k){
-        //Again check if empty and then go through tree looking for key
-        if(is_empty()){
-            throw std::runtime_error("Cannot lookup in an empty map");
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: difference_nodes(node* a, node* b, size_t workers, std::vector<node*>& garbage){
+        //Nothing left to remove from, or nothing left to remove
+        if(!a){
+            if(b){
+                garbage.push_back(b);
+            }
+            return nullptr;
+        }
+
+        if(!b){
+            return a;
+        }
+
+        //Split a around b's root this time, since b's keys are the ones going away
+        node* less;
+        node* greater;
+        node* found = split_node(a, b->key, less, greater);
+        node* b_left = b->left;
+        node* b_right = b->right;
+
+        node* left;
+        node* right;
+        run_halves(&basic_AVL::difference_nodes, less, b_left, greater, b_right, left, right, workers, garbage);
+
+        b->left = nullptr;
+        b->right = nullptr;
+        garbage.push_back(b);
+        if(found){
+            garbage.push_back(found);
+        }
+
+        return join_pair(left, right);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: free_garbage(std::vector<node*>& garbage){
+        for(size_t i = 0; i < garbage.size(); i++){
+            deletion(garbage[i]);
+        }
+        garbage.clear();
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    size_t basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: worker_count(){
+        //Counters are plain integers, so a tree counting stats keeps every half on this thread
+        if(stats_policy::enabled){
+            return 1;
+        }
+
+        //hardware_concurrency may not know, then stay on one thread
+        size_t workers = std::thread::hardware_concurrency();
+        if(workers == 0){
+            return 1;
         }
 
+        return workers;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename key_arg, typename... value_args>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: put(key_arg&& k, bool assign, value_args&&... args){
+        //Recursive insert reports back whether a new node was made
+        bool inserted = false;
+        root = insert_at_leaf(root, std::forward<key_arg>(k), assign, inserted, std::forward<value_args>(args)...); //Root may change after rotations
+        return inserted;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename value_arg>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: assign_value(value_type& target, value_arg&& v){
+        //Assign straight over the old value when possible, so a copy can reuse its storage
+        //Otherwise (say an explicit conversion) build a new value and move it in
+        if constexpr(std::is_assignable<value_type&, value_arg&&>::value){
+            target = std::forward<value_arg>(v);
+        }
+        else{
+            target = value_type(std::forward<value_arg>(v));
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename... value_args>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: assign_value(value_type& target, value_args&&... args){
+        //Several arguments only come from emplace, build the value and move it in
+        target = value_type(std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename key_like>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: node* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: find_node(const key_like& k){
+        //Plain descent, shared by every lookup so transparent keys walk the tree the same way
         node* curr = root;
+        counters.looked_up();
 
         while(curr){
+            counters.visited();
+            int order = compare_keys(k, curr->key); //One comparison picks the branch
             //Key matched node we are on
-            if(equals(k, curr->key)){
-                return curr->value;
+            if(order == 0){
+                return curr;
             }
             //Key comes before node we are on, go left
-            else if(compare(k, curr->key)){
+            else if(order < 0){
                 curr = curr->left;
             }
             //Go right
@@ -401,35 +938,302 @@ namespace cop3530{
             }
         }
 
-        //No key was found, return error
-        throw std::runtime_error("Given key was not in the map to lookup");
+        return nullptr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    bool AVL<key_type, value_type, compare, equals> :: contains(key_type k){
-        //Same as lookup, just returning bool instead of value
-        if(is_empty()){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename function>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: update_at(node* curr, const key_type& k, function& f){
+        //Recursive like insert, every node on the way down is one whose summary covers k's value
+        if(!curr){
             return false;
         }
 
-        node* curr = root;
-        while(curr){
-            if(equals(k, curr->key)){
-                return true;
+        counters.visited();
+        int order = compare_keys(k, curr->key); //One comparison picks the branch
+
+        //Summary is refreshed even if f throws part way, a half changed value is still in it then
+        try{
+            if(order == 0){
+                f(curr->value);
             }
-            else if(compare(k, curr->key)){
-                curr = curr->left;
+            else if(!update_at(order < 0 ? curr->left : curr->right, k, f)){
+                return false;
             }
-            else{
-                curr = curr->right;
+        }
+        catch(...){
+            refresh_summary(curr);
+            throw;
+        }
+
+        refresh_summary(curr);
+        return true;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: prefetch(const void* p){
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p);
+#else
+        (void)p;
+#endif
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename visit>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: find_nodes(const key_type* keys, size_t n, visit found){
+        //Up to batch_lanes descents take turns, each one step at a time, and every step prefetches the child it moves to
+        //By the time a lane comes around again its node has usually arrived, so the lanes wait on their misses together instead of one after another
+        //A lane that finishes takes the next key right away, so a deep search never holds up the rest
+        struct lane{
+            node* curr;
+            size_t index;
+        };
+
+        lane lanes[batch_lanes];
+        size_t active = 0;
+        size_t next = 0;
+
+        //Nothing to walk, every key is missing
+        if(!root){
+            for(size_t i = 0; i < n; i++){
+                counters.looked_up();
+                found(i, nullptr);
             }
+            return;
         }
 
-        return false;
+        //Root is shared by every descent and stays in cache, no need to prefetch it
+        while(active < batch_lanes && next < n){
+            counters.looked_up();
+            lanes[active].curr = root;
+            lanes[active].index = next;
+            active++;
+            next++;
+        }
+
+        while(active > 0){
+            size_t i = 0;
+            while(i < active){
+                lane& l = lanes[i];
+                counters.visited();
+                int order = compare_keys(keys[l.index], l.curr->key); //One comparison picks the branch
+
+                //Key matched node this lane is on
+                if(order == 0){
+                    found(l.index, l.curr);
+                }
+                else{
+                    //Step down and start loading the child, it is looked at after every other lane has had its turn
+                    l.curr = order < 0 ? l.curr->left : l.curr->right;
+                    if(l.curr){
+                        prefetch(l.curr);
+                        i++;
+                        continue;
+                    }
+
+                    //Fell off the bottom, key is missing
+                    found(l.index, nullptr);
+                }
+
+                //Lane is done, give it the next key or close it by moving the last lane into its place
+                if(next < n){
+                    counters.looked_up();
+                    l.curr = root;
+                    l.index = next;
+                    next++;
+                    i++;
+                }
+                else{
+                    active--;
+                    l = lanes[active];
+                }
+            }
+        }
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    bool AVL<key_type, value_type, compare, equals> :: is_empty(){
+    //PUBLIC FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: insert(const key_type& k, const value_type& v){
+        //Single descent insert, key must not already be in map
+        if(!put(k, false, v)){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: try_insert(const key_type& k, const value_type& v){
+        //Leaves an existing value untouched, returns whether k-v pair was added
+        return put(k, false, v);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: insert_or_assign(const key_type& k, const value_type& v){
+        //Overwrites an existing value, returns whether k-v pair was added
+        return put(k, true, v);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: insert(key_type&& k, value_type&& v){
+        //Same as copying insert, key and value are moved into the new node
+        if(!put(std::move(k), false, std::move(v))){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: try_insert(key_type&& k, value_type&& v){
+        //Nothing is moved from if key is already in map
+        return put(std::move(k), false, std::move(v));
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: insert_or_assign(key_type&& k, value_type&& v){
+        //Value is moved over the old one, or key and value are moved into a new node
+        return put(std::move(k), true, std::move(v));
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename... value_args>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: emplace(const key_type& k, value_args&&... args){
+        //Value is only built once the descent reaches an empty spot, so a duplicate key costs no construction
+        return put(k, false, std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename... value_args>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: emplace(key_type&& k, value_args&&... args){
+        return put(std::move(k), false, std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: remove(const key_type& k){
+        //Check if empty to avoid errors, then call recursive function to remove
+        if(is_empty()){
+            throw std::runtime_error("Cannot remove from an empty map");
+        }
+
+        if(!contains(k)){
+            throw std::runtime_error("Key is not in map");
+        }
+
+        root = do_delete(root, k); //Root may change after rotations
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: exposed_value& basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: lookup(const key_type& k){
+        //Again check if empty and then go through tree looking for key
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        exposed_value* found = find(k);
+
+        //No key was found, return error
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: exposed_value* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: find(const key_type& k){
+        //Same walk as lookup, but a miss is reported with nullptr instead of an exception
+        node* found = find_node(k);
+
+        if(!found){
+            return nullptr;
+        }
+
+        return &found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    value_type basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: lookup_or(const key_type& k, const value_type& fallback){
+        //One descent, hands back a copy of fallback if key is missing
+        exposed_value* found = find(k);
+
+        if(!found){
+            return fallback;
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename function>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: update(const key_type& k, function f){
+        //Same as changing the value lookup returns, but the summaries aggregate reads are kept right
+        if(is_empty()){
+            throw std::runtime_error("Cannot update in an empty map");
+        }
+
+        counters.looked_up();
+        if(!update_at(root, k, f)){
+            throw std::runtime_error("Given key was not in the map to update");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: contains(const key_type& k){
+        //Same as lookup, just returning bool instead of value
+        return find(k) != nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename key_like, typename key_comparator, typename transparent>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: exposed_value& basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: lookup(const key_like& k){
+        //Same as lookup by key, but k is compared as is without building a key_type
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        node* found = find_node(k);
+
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename key_like, typename key_comparator, typename transparent>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: exposed_value* basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: find(const key_like& k){
+        node* found = find_node(k);
+
+        if(!found){
+            return nullptr;
+        }
+
+        return &found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename key_like, typename key_comparator, typename transparent>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: contains(const key_like& k){
+        return find_node(k) != nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: lookup_batch(const key_type* keys, size_t n, exposed_value** out){
+        //Same answers as calling find on every key, misses are nullptr instead of an exception so one bad key doesn't lose the rest
+        find_nodes(keys, n, [out](size_t i, node* found){
+            out[i] = found ? &found->value : nullptr;
+        });
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: contains_batch(const key_type* keys, size_t n, bool* out){
+        find_nodes(keys, n, [out](size_t i, node* found){
+            out[i] = found != nullptr;
+        });
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: is_empty(){
         //BST only empty if root doesnt exist
         if(!root){
             return true;
@@ -438,39 +1242,427 @@ namespace cop3530{
         return false;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    bool AVL<key_type, value_type, compare, equals> :: is_full(){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    bool basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: is_full(){
         //BST never full
         return false;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    size_t AVL<key_type, value_type, compare, equals> :: size(){
-        //Calls on the recursive function for size
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    size_t basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: size(){
+        //Root's cached size covers the whole tree
         return get_size(root);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void AVL<key_type, value_type, compare, equals> :: clear(){
-        //Calls recursive deletion, then sets root to nullptr to indicate empty
-        deletion(root);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: clear(){
+        //Calls recursive deletion unless allocator can free every node at once, then sets root to nullptr to indicate empty
+        //Same as the destructor, a shared pool can't just drop its nodes
+        if(!allocator<node>::bulk_release || alloc.shared()){
+            deletion(root);
+        }
+        else{
+            counters.freed(size()); //Nodes go all at once, so they are counted here instead of one by one
+        }
+
+        alloc.release_all();
         root = nullptr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    int AVL<key_type, value_type, compare, equals> :: height(){
-        //Calls recursive function height and subtracts 1 to get rid of counting root as 1
-        return get_height(root) - 1;
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    int basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: height(){
+        //Root's cached height minus 1 to get rid of counting root as 1
+        if(balance_policy::rank_is_height){
+            return get_rank(root) - 1;
+        }
+
+        //Other policies' ranks only bound the height, so the tree is measured
+        return (int)measure_shape<key_type>(root, 0).levels - 1;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    int basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: balance(){
+        //Cached heights make this constant time, empty tree has balance 0
+        if(balance_policy::rank_is_height || !root){
+            return get_balance(root);
+        }
+
+        //Ranks aren't heights, measure both sides instead
+        return (int)measure_shape<key_type>(root->left, 0).levels - (int)measure_shape<key_type>(root->right, 0).levels;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    tree_shape<key_type> basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: shape_report(size_t worst){
+        //Unlike height and balance, this looks at every subtree, and each node only once
+        return measure_shape<key_type>(root, worst);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    tree_stats basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: stats(){
+        return counters.get();
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: reset_stats(){
+        counters.reset();
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    const key_type& basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: select(size_t i){
+        //Uses subtree sizes to pick a side, so only one path is walked
+        if(i >= size()){
+            throw std::runtime_error("Select index is out of range");
+        }
+
+        node* curr = root;
+
+        while(curr){
+            size_t left_size = get_size(curr->left);
+
+            //Exactly i smaller keys, this is the one
+            if(i == left_size){
+                return curr->key;
+            }
+            //Key is somewhere in the left subtree
+            else if(i < left_size){
+                curr = curr->left;
+            }
+            //Skip the left subtree and this node
+            else{
+                i -= left_size + 1;
+                curr = curr->right;
+            }
+        }
+
+        //Subtree sizes are out of sync, should never get here
+        throw std::runtime_error("Select index is out of range");
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    size_t basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: rank(const key_type& k){
+        //Number of keys strictly smaller than k
+        return count_less(k, false);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    int AVL<key_type, value_type, compare, equals> :: balance(){
-        //If empty or size == 1, then its 0, otherwise left - right
-        if(is_empty() || size() == 1){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    size_t basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: count_in_range(const key_type& lo, const key_type& hi){
+        //Keys <= hi minus keys < lo gives keys in [lo, hi]
+        if(compare_keys(hi, lo) < 0){
             return 0;
         }
 
-        return get_height(root->left) - get_height(root->right);
+        return count_less(hi, true) - count_less(lo, false);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename augment_policy::summary_type basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: aggregate(const key_type& lo, const key_type& hi){
+        //Values can only change through insert_or_assign and update while summaries are kept, and both refresh them
+        static_assert(augment_policy::enabled, "aggregate needs an augment_policy, such as sum_augment");
+
+        //Walk down to the first node in [lo, hi], every key in the range is in its subtree
+        node* top = root;
+        while(top){
+            if(compare_keys(lo, top->key) > 0){
+                top = top->right;
+            }
+            else if(compare_keys(hi, top->key) < 0){
+                top = top->left;
+            }
+            else{
+                break;
+            }
+        }
+
+        if(!top){
+            return augment_policy::identity();
+        }
+
+        //Down the left side: a node not less than lo is in range and so is all of its right subtree,
+        //both come before what was gathered so far. Otherwise only its right subtree can hold range keys
+        typename augment_policy::summary_type low = augment_policy::identity();
+        node* curr = top->left;
+        while(curr){
+            if(compare_keys(lo, curr->key) <= 0){
+                low = augment_policy::combine(augment_policy::combine(augment_policy::of(curr->key, curr->value), get_summary(curr->right)), low);
+                curr = curr->left;
+            }
+            else{
+                curr = curr->right;
+            }
+        }
+
+        //Mirror on the right side, whole left subtrees of nodes not greater than hi come after what was gathered
+        typename augment_policy::summary_type high = augment_policy::identity();
+        curr = top->right;
+        while(curr){
+            if(compare_keys(hi, curr->key) >= 0){
+                high = augment_policy::combine(high, augment_policy::combine(get_summary(curr->left), augment_policy::of(curr->key, curr->value)));
+                curr = curr->right;
+            }
+            else{
+                curr = curr->left;
+            }
+        }
+
+        return augment_policy::combine(augment_policy::combine(low, augment_policy::of(top->key, top->value)), high);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    template<typename pair_iterator>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: build_from_sorted(pair_iterator first, pair_iterator last){
+        //Pairs need .first as key and .second as value, keys strictly increasing
+        //First pass counts and checks order, so nothing is changed if input is bad
+        size_t n = 0;
+        pair_iterator prev = first;
+
+        for(pair_iterator it = first; it != last; ++it){
+            if(n > 0 && compare_keys(prev->first, it->first) >= 0){
+                throw std::runtime_error("Keys given to build_from_sorted are not strictly increasing");
+            }
+
+            prev = it;
+            n++;
+        }
+
+        //Second pass builds the tree bottom up without any comparisons or rotations
+        clear();
+        root = build_balanced(first, n);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    basic_FROZEN<key_type, value_type, comparator> basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: freeze(){
+        //Iterator already walks the keys in order, which is all FROZEN needs
+        return basic_FROZEN<key_type, value_type, comparator>(begin(), size());
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: save(const std::string& path){
+        //Iterator walks keys in order, which is the order the file needs
+        write_snapshot<key_type, value_type>(path, begin(), size());
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: load(const std::string& path){
+        //Header and checksum are checked when the file is opened, and build_from_sorted checks the order
+        //before clearing, so a bad file throws with the map untouched
+        basic_SNAPSHOT<key_type, value_type, comparator> file(path);
+        build_from_sorted(file.pairs_begin(), file.pairs_end());
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: join(const key_type& k, const value_type& v, basic_AVL&& b){
+        //Order is checked against the largest key here and smallest in b, so nothing changes if it's wrong
+        if(this == &b){
+            throw std::runtime_error("Cannot join a map with itself");
+        }
+
+        if(root){
+            node* max = root;
+            while(max->right){
+                max = max->right;
+            }
+            if(compare_keys(max->key, k) >= 0){
+                throw std::runtime_error("Keys given to join are not in order");
+            }
+        }
+
+        if(b.root){
+            node* min = b.root;
+            while(min->left){
+                min = min->left;
+            }
+            if(compare_keys(k, min->key) >= 0){
+                throw std::runtime_error("Keys given to join are not in order");
+            }
+        }
+
+        //b's nodes are relinked into this tree, so they have to belong to this allocator now
+        node* mid = alloc.allocate(k, v);
+        counters.allocated();
+        alloc.splice(b.alloc);
+        root = join_nodes(root, mid, b.root);
+        b.root = nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: join(basic_AVL&& b){
+        if(this == &b){
+            throw std::runtime_error("Cannot join a map with itself");
+        }
+
+        //Same check as above, but largest key here and smallest in b only have to be in order with each other
+        if(root && b.root){
+            node* max = root;
+            while(max->right){
+                max = max->right;
+            }
+
+            node* min = b.root;
+            while(min->left){
+                min = min->left;
+            }
+
+            if(compare_keys(max->key, min->key) >= 0){
+                throw std::runtime_error("Keys given to join are not in order");
+            }
+        }
+
+        alloc.splice(b.alloc);
+        root = join_pair(root, b.root);
+        b.root = nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: split(const key_type& k){
+        //Node holding k, if any, goes back as the smallest key of the greater half
+        node* less;
+        node* greater;
+        node* found = split_node(root, k, less, greater);
+        if(found){
+            greater = join_nodes(nullptr, found, greater);
+        }
+        root = less;
+
+        //Nodes stay where they are. A pool can't hand its nodes to another pool, so the new tree's pool shares its arena
+        basic_AVL result;
+        result.alloc.share(alloc);
+        result.root = greater;
+
+        return result;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: set_union(basic_AVL&& b){
+        //Union with itself changes nothing
+        if(this == &b){
+            return;
+        }
+
+        //Discarded nodes are freed after every thread is done, so the allocator is only used from here
+        std::vector<node*> garbage;
+        alloc.splice(b.alloc);
+        root = union_nodes(root, b.root, worker_count(), garbage);
+        b.root = nullptr;
+        free_garbage(garbage);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: set_intersection(basic_AVL&& b){
+        //Intersection with itself changes nothing
+        if(this == &b){
+            return;
+        }
+
+        std::vector<node*> garbage;
+        alloc.splice(b.alloc);
+        root = intersection_nodes(root, b.root, worker_count(), garbage);
+        b.root = nullptr;
+        free_garbage(garbage);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    void basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: set_difference(basic_AVL&& b){
+        //Difference with itself leaves nothing
+        if(this == &b){
+            clear();
+            return;
+        }
+
+        std::vector<node*> garbage;
+        alloc.splice(b.alloc);
+        root = difference_nodes(root, b.root, worker_count(), garbage);
+        b.root = nullptr;
+        free_garbage(garbage);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: iterator basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: begin(){
+        //Smallest key is all the way down the left side
+        iterator it(root);
+        it.push_leftmost(root);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: iterator basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: end(){
+        return iterator(root);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: iterator basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: lower_bound(const key_type& k){
+        //Walks down once, remembering how deep the last node with key >= k was
+        iterator it(root);
+        size_t keep = 0;
+        node* curr = root;
+
+        while(curr){
+            it.path.push_back(curr);
+
+            //Node key >= k is a candidate, a smaller one can only be to the left
+            if(compare_keys(curr->key, k) >= 0){
+                keep = it.path.size();
+                curr = curr->left;
+            }
+            else{
+                curr = curr->right;
+            }
+        }
+
+        //Cut path back to the candidate, no candidate leaves it empty which is end()
+        it.path.resize(keep);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: iterator basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: upper_bound(const key_type& k){
+        //Same walk as lower_bound, but candidate key must be strictly greater
+        iterator it(root);
+        size_t keep = 0;
+        node* curr = root;
+
+        while(curr){
+            it.path.push_back(curr);
+
+            if(compare_keys(k, curr->key) < 0){
+                keep = it.path.size();
+                curr = curr->left;
+            }
+            else{
+                curr = curr->right;
+            }
+        }
+
+        it.path.resize(keep);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: iterator basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: floor(const key_type& k){
+        //Mirror of lower_bound, candidate is a key <= k and a larger one can only be to the right
+        iterator it(root);
+        size_t keep = 0;
+        node* curr = root;
+
+        while(curr){
+            it.path.push_back(curr);
+
+            if(compare_keys(k, curr->key) >= 0){
+                keep = it.path.size();
+                curr = curr->right;
+            }
+            else{
+                curr = curr->left;
+            }
+        }
+
+        it.path.resize(keep);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy, typename balance_policy, typename augment_policy>
+    typename basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: iterator basic_AVL<key_type, value_type, comparator, allocator, stats_policy, balance_policy, augment_policy> :: ceiling(const key_type& k){
+        //Smallest key >= k is exactly what lower_bound finds
+        return lower_bound(k);
     }
 }
 
@@ -0,0 +1,258 @@
+#ifndef BALANCE_H_INCLUDED
+#define BALANCE_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+
+namespace cop3530{
+
+    //Balance policies used by AVL. Every node keeps an int rank that only the policy gives meaning to,
+    //nullptr counts as rank 0 and a new leaf starts at 1. After an insert or a join the tree calls grew on
+    //every node on the way back up, after a remove it calls shrank, and each returns the subtree's new root.
+    //The tree refreshes sizes (and ranks, if rank_is_height) before each call. Policies rotate through the
+    //tree's rotate_left and rotate_right, so AVL makes them friends
+
+    //Plain AVL: rank is the height, and a node whose sides differ by more than 1 is fixed with one
+    //single or double rotation. A remove can rotate at every level on the way up
+    struct avl_balance{
+        static const bool rank_is_height = true; //Tree recomputes ranks from children in update_node
+
+        template<typename tree_type, typename node_type> static node_type* grew(tree_type& t, node_type* curr); //A child's rank went up
+        template<typename tree_type, typename node_type> static node_type* shrank(tree_type& t, node_type* curr); //A child's rank went down
+        template<typename tree_type, typename node_type> static node_type* fix(tree_type& t, node_type* curr); //Both of the above, heights tell which side is heavy
+    };
+
+    //Weak AVL (Haeupler, Sen and Tarjan): every child's rank is 1 or 2 below its parent's and a leaf has rank 1.
+    //Ranks change by promotions and demotions, which are just writes. Insert does at most 2 rotations, same as AVL,
+    //and remove at most 2 as well instead of one per level. Rebalancing steps are amortized O(1) per update.
+    //With no removes the tree is exactly an AVL tree, removes can make it up to about 2 log n tall
+    struct wavl_balance{
+        static const bool rank_is_height = false; //Ranks only move by explicit promotions and demotions
+
+        template<typename tree_type, typename node_type> static node_type* grew(tree_type& t, node_type* curr);
+        template<typename tree_type, typename node_type> static node_type* shrank(tree_type& t, node_type* curr);
+    };
+
+    //AVL BALANCE
+
+    template<typename tree_type, typename node_type>
+    node_type* avl_balance :: grew(tree_type& t, node_type* curr){
+        return fix(t, curr);
+    }
+
+    template<typename tree_type, typename node_type>
+    node_type* avl_balance :: shrank(tree_type& t, node_type* curr){
+        return fix(t, curr);
+    }
+
+    template<typename tree_type, typename node_type>
+    node_type* avl_balance :: fix(tree_type& t, node_type* curr){
+        //Checks if bf is not in range of -1<bf<1. Does corresponding rotation if not in range
+        //Child's balance picks single or double rotation, so no key comparisons are needed
+        int bf = t.get_balance(curr);
+
+        //Left heavy. Left left is one rotation, left right rotates the child first
+        if(bf > 1){
+            if(t.get_balance(curr->left) < 0){
+                t.counters.rotated_lr();
+                curr->left = t.rotate_left(curr->left);
+            }
+            else{
+                t.counters.rotated_ll();
+            }
+            return t.rotate_right(curr);
+        }
+
+        //Right heavy, mirror of the above
+        if(bf < -1){
+            if(t.get_balance(curr->right) > 0){
+                t.counters.rotated_rl();
+                curr->right = t.rotate_right(curr->right);
+            }
+            else{
+                t.counters.rotated_rr();
+            }
+            return t.rotate_left(curr);
+        }
+
+        return curr;
+    }
+
+    //WAVL BALANCE
+
+    template<typename tree_type, typename node_type>
+    node_type* wavl_balance :: grew(tree_type& t, node_type* curr){
+        //Only problem an insert or join makes is a child with the same rank as curr (a 0-child)
+        int r = curr->rank;
+
+        //Left side is the 0-child
+        if(t.get_rank(curr->left) == r){
+            //Other side is a 1-child, promoting curr fixes this node and maybe makes curr its parent's 0-child
+            if(r - t.get_rank(curr->right) == 1){
+                curr->rank++;
+                return curr;
+            }
+
+            node_type* z = curr->left;
+            int z_rank = z->rank;
+
+            //Inner child of z is a 2-child, one rotation and curr goes down a rank. Subtree keeps its rank
+            if(z_rank - t.get_rank(z->right) == 2){
+                t.counters.rotated_ll();
+                curr = t.rotate_right(curr);
+                curr->right->rank--;
+                return curr;
+            }
+
+            //Inner child is a 1-child and outer a 2-child, inner one goes up two levels. Subtree keeps its rank
+            if(z_rank - t.get_rank(z->left) == 2){
+                t.counters.rotated_lr();
+                node_type* old = curr;
+                curr->left = t.rotate_left(z);
+                curr = t.rotate_right(curr);
+                curr->rank++;
+                z->rank--;
+                old->rank--;
+                return curr;
+            }
+
+            //Both children of z are 1-children, only a join makes this. z goes up and is promoted, subtree grows a rank
+            t.counters.rotated_ll();
+            curr = t.rotate_right(curr);
+            curr->rank++;
+            return curr;
+        }
+
+        //Mirror, right side is the 0-child
+        if(t.get_rank(curr->right) == r){
+            if(r - t.get_rank(curr->left) == 1){
+                curr->rank++;
+                return curr;
+            }
+
+            node_type* z = curr->right;
+            int z_rank = z->rank;
+
+            if(z_rank - t.get_rank(z->left) == 2){
+                t.counters.rotated_rr();
+                curr = t.rotate_left(curr);
+                curr->left->rank--;
+                return curr;
+            }
+
+            if(z_rank - t.get_rank(z->right) == 2){
+                t.counters.rotated_rl();
+                node_type* old = curr;
+                curr->right = t.rotate_right(z);
+                curr = t.rotate_left(curr);
+                curr->rank++;
+                z->rank--;
+                old->rank--;
+                return curr;
+            }
+
+            t.counters.rotated_rr();
+            curr = t.rotate_left(curr);
+            curr->rank++;
+            return curr;
+        }
+
+        return curr;
+    }
+
+    template<typename tree_type, typename node_type>
+    node_type* wavl_balance :: shrank(tree_type& t, node_type* curr){
+        //A remove below can leave curr a leaf of rank 2 (both sides 2-children), or give it a 3-child
+        if(!curr->left && !curr->right){
+            curr->rank = 1;
+            return curr;
+        }
+
+        int r = curr->rank;
+
+        //Left side is the 3-child, y is its sibling
+        if(r - t.get_rank(curr->left) == 3){
+            node_type* y = curr->right;
+            int y_rank = y->rank;
+
+            //Sibling is a 2-child, demoting curr fixes this node and maybe makes curr its parent's 3-child
+            if(r - y_rank == 2){
+                curr->rank--;
+                return curr;
+            }
+
+            //Sibling is a 1-child with two 2-children, demote both
+            if(y_rank - t.get_rank(y->left) == 2 && y_rank - t.get_rank(y->right) == 2){
+                curr->rank--;
+                y->rank--;
+                return curr;
+            }
+
+            //Sibling's outer child is a 1-child, one rotation. Subtree keeps its rank and the remove is done
+            if(y_rank - t.get_rank(y->right) == 1){
+                t.counters.rotated_rr();
+                node_type* old = curr;
+                curr = t.rotate_left(curr);
+                curr->rank++;
+                old->rank--;
+                //A leaf can't keep rank 2, so it goes down one more
+                if(!old->left && !old->right){
+                    old->rank = 1;
+                }
+                return curr;
+            }
+
+            //Outer child is a 2-child so inner one is a 1-child, it goes up two levels
+            t.counters.rotated_rl();
+            node_type* old = curr;
+            curr->right = t.rotate_right(y);
+            curr = t.rotate_left(curr);
+            curr->rank += 2;
+            y->rank--;
+            old->rank -= 2;
+            return curr;
+        }
+
+        //Mirror, right side is the 3-child
+        if(r - t.get_rank(curr->right) == 3){
+            node_type* y = curr->left;
+            int y_rank = y->rank;
+
+            if(r - y_rank == 2){
+                curr->rank--;
+                return curr;
+            }
+
+            if(y_rank - t.get_rank(y->left) == 2 && y_rank - t.get_rank(y->right) == 2){
+                curr->rank--;
+                y->rank--;
+                return curr;
+            }
+
+            if(y_rank - t.get_rank(y->left) == 1){
+                t.counters.rotated_ll();
+                node_type* old = curr;
+                curr = t.rotate_right(curr);
+                curr->rank++;
+                old->rank--;
+                if(!old->left && !old->right){
+                    old->rank = 1;
+                }
+                return curr;
+            }
+
+            t.counters.rotated_lr();
+            node_type* old = curr;
+            curr->left = t.rotate_left(y);
+            curr = t.rotate_right(curr);
+            curr->rank += 2;
+            y->rank--;
+            old->rank -= 2;
+            return curr;
+        }
+
+        return curr;
+    }
+
+}
+
+#endif
@@ -0,0 +1,218 @@
+//Delete heavy churn benchmark for AVL's balance policies
+//Builds each tree from the same random keys, then times the same removes and inserts on it and reports them as JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread BALANCEBENCHMARK.cpp -o balancebenchmark
+//    ./balancebenchmark > balance.json
+//
+//Options:
+//    --sizes=100000,1000000      Pairs in each tree, default is those
+//    --churn=N                   Remove and insert pairs after the build, default 2000000
+//    --seed=N                    Seed for keys and operations, default 12345
+//
+//Phases, each on the tree the one before left:
+//    churn    removes a random key in the tree and inserts a new one, so the size stays the same
+//    drain    removes 3 of every 4 keys in random order
+//    refill   inserts new keys until the tree is back to its size
+//Timed runs use no_stats. Each phase is run again on a count_stats tree for the rotations,
+//rotations counts a double rotation once. height_after is from the timed tree
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtoull
+#include <cstring> //For parsing options
+#include <cstdint> //For 8 byte keys
+#include <vector> //For keys and operations
+#include <random> //For keys and operations
+#include <chrono> //For timing
+#include <algorithm> //For shuffling
+#include "AVL.h"
+
+typedef uint64_t key_type;
+typedef uint64_t value_type;
+
+//RUNNER
+
+struct options{
+    std::vector<size_t> sizes;
+    size_t churn;
+    unsigned long long seed;
+};
+
+//Same operations for every tree, made up front so each tree sees them in the same order
+struct workload{
+    std::vector<key_type> keys; //Built from these, in this order
+    std::vector<key_type> churn_removes; //Churn removes churn_removes[i], then inserts churn_inserts[i]
+    std::vector<key_type> churn_inserts;
+    std::vector<key_type> drain; //Keys left after churn, removed in this order
+    std::vector<key_type> refill; //New keys inserted after the drain
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+static void report(const char* name, const char* phase, size_t size, size_t ops, double seconds, uint64_t rotations, int height){
+    printf("%s\n    {\"structure\": \"%s\", \"phase\": \"%s\", \"size\": %zu, \"ops\": %zu, \"seconds\": %.4f, \"ns_per_op\": %.2f, \"rotations\": %llu, \"height_after\": %d}",
+           first_result ? "" : ",", name, phase, size, ops, seconds, ops ? seconds * 1e9 / ops : 0.0, (unsigned long long)rotations, height);
+    first_result = false;
+    fflush(stdout);
+}
+
+static uint64_t rotations(const cop3530::tree_stats& s){
+    return s.rotations_ll + s.rotations_lr + s.rotations_rr + s.rotations_rl;
+}
+
+//Each phase returns its time, the counted tree goes through the same phases untimed
+template<typename tree_type>
+static double run_churn(tree_type& t, const workload& w){
+    bench_clock::time_point start = bench_clock::now();
+    for(size_t i = 0; i < w.churn_removes.size(); i++){
+        t.remove(w.churn_removes[i]);
+        t.insert(w.churn_inserts[i], w.churn_inserts[i]);
+    }
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+template<typename tree_type>
+static double run_drain(tree_type& t, const workload& w){
+    bench_clock::time_point start = bench_clock::now();
+    for(key_type k : w.drain){
+        t.remove(k);
+    }
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+template<typename tree_type>
+static double run_refill(tree_type& t, const workload& w){
+    bench_clock::time_point start = bench_clock::now();
+    for(key_type k : w.refill){
+        t.insert(k, k);
+    }
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+template<typename balance_policy>
+static void run_tree(const char* name, const workload& w){
+    using namespace cop3530;
+    basic_AVL<key_type, value_type, three_way_compare<key_type>, heap_allocator, no_stats, balance_policy> t;
+    basic_AVL<key_type, value_type, three_way_compare<key_type>, heap_allocator, count_stats, balance_policy> counted;
+
+    bench_clock::time_point start = bench_clock::now();
+    for(key_type k : w.keys){
+        t.insert(k, k);
+    }
+    double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    for(key_type k : w.keys){
+        counted.insert(k, k);
+    }
+    report(name, "build", w.keys.size(), w.keys.size(), seconds, rotations(counted.stats()), t.height());
+
+    counted.reset_stats();
+    seconds = run_churn(t, w);
+    run_churn(counted, w);
+    report(name, "churn", w.keys.size(), 2 * w.churn_removes.size(), seconds, rotations(counted.stats()), t.height());
+
+    counted.reset_stats();
+    seconds = run_drain(t, w);
+    run_drain(counted, w);
+    report(name, "drain", w.keys.size(), w.drain.size(), seconds, rotations(counted.stats()), t.height());
+
+    counted.reset_stats();
+    seconds = run_refill(t, w);
+    run_refill(counted, w);
+    report(name, "refill", w.keys.size(), w.refill.size(), seconds, rotations(counted.stats()), t.height());
+}
+
+static void run_size(size_t size, const options& opt){
+    using namespace cop3530;
+
+    //Every key made is distinct, low bits count them
+    std::mt19937_64 gen(opt.seed + size);
+    uint64_t made = 0;
+    auto new_key = [&gen, &made](){ return (gen() & 0xffffffff00000000ull) | made++; };
+
+    workload w;
+    std::vector<key_type> present(size);
+    for(size_t i = 0; i < size; i++){
+        present[i] = new_key();
+    }
+    w.keys = present;
+
+    //Removes pick from what is in the tree at that point, so every one of them is a hit
+    w.churn_removes.resize(opt.churn);
+    w.churn_inserts.resize(opt.churn);
+    for(size_t i = 0; i < opt.churn; i++){
+        size_t slot = gen() % size;
+        w.churn_removes[i] = present[slot];
+        w.churn_inserts[i] = new_key();
+        present[slot] = w.churn_inserts[i];
+    }
+
+    std::shuffle(present.begin(), present.end(), gen);
+    w.drain.assign(present.begin(), present.begin() + size - size / 4);
+    w.refill.resize(size - size / 4);
+    for(size_t i = 0; i < w.refill.size(); i++){
+        w.refill[i] = new_key();
+    }
+
+    run_tree<avl_balance>("AVL avl_balance", w);
+    run_tree<wavl_balance>("AVL wavl_balance", w);
+}
+
+static std::vector<size_t> parse_list(const char* p){
+    std::vector<size_t> values;
+    while(*p){
+        char* end;
+        values.push_back((size_t)strtoull(p, &end, 10));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.churn = 2000000;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--sizes=", 8) == 0){
+            opt.sizes = parse_list(arg + 8);
+        }
+        else if(strncmp(arg, "--churn=", 8) == 0){
+            opt.churn = strtoull(arg + 8, nullptr, 10);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.sizes.empty()){
+        opt.sizes = {100000, 1000000};
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    printf("{\n  \"config\": {\"churn\": %zu, \"seed\": %llu},\n  \"results\": [", opt.churn, opt.seed);
+
+    for(size_t size : opt.sizes){
+        if(size > 0){
+            run_size(size, opt);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
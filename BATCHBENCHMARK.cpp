@@ -0,0 +1,178 @@
+//Batched lookups against one find per key, for AVL and the three BSTs
+//Builds each tree from the same random keys, then times the same queries both ways and reports them as JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread BATCHBENCHMARK.cpp -o batchbenchmark
+//    ./batchbenchmark > batch.json
+//
+//Options:
+//    --sizes=100000,1000000      Pairs in each tree, default is those
+//    --batches=16,64,512         Keys handed to each lookup_batch call, default is those
+//    --queries=N                 Lookups timed per tree, size and batch, default 2000000
+//    --seed=N                    Seed for keys and queries, default 12345
+//
+//Queries are half hits and half misses. scalar is a loop of find over the same queries, speedup is its time
+//over the batch's. Once a tree is bigger than the last level cache most steps of a descent are misses,
+//which is where running several descents at once pays off. Small trees that fit in cache gain little or nothing
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtoull
+#include <cstring> //For parsing options
+#include <cstdint> //For 8 byte keys
+#include <vector> //For keys and queries
+#include <random> //For keys and queries
+#include <chrono> //For timing
+#include <algorithm> //For shuffling
+#include "AVL.h"
+#include "BSTLEAF.h"
+#include "BSTROOT.h"
+#include "BSTRAND.h"
+
+typedef uint64_t key_type;
+typedef uint64_t value_type;
+
+//RUNNER
+
+struct options{
+    std::vector<size_t> sizes;
+    std::vector<size_t> batches;
+    size_t queries;
+    unsigned long long seed;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+static double seconds_since(bench_clock::time_point start){
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+static void report(const char* name, size_t size, size_t batch, size_t ops, double seconds, double scalar_seconds, unsigned long long checksum){
+    printf("%s\n    {\"structure\": \"%s\", \"size\": %zu, \"batch\": %zu, \"ops\": %zu, \"seconds\": %.4f, \"ns_per_op\": %.2f, \"speedup\": %.2f, \"checksum\": %llu}",
+           first_result ? "" : ",", name, size, batch, ops, seconds, ops ? seconds * 1e9 / ops : 0.0, seconds > 0 ? scalar_seconds / seconds : 0.0, checksum);
+    first_result = false;
+    fflush(stdout);
+}
+
+//Sums found values so neither loop can be optimized away, the checksums of one tree must all match
+template<typename tree_type>
+static void run_tree(const char* name, const std::vector<key_type>& keys, const std::vector<key_type>& queries, const options& opt){
+    tree_type t;
+    for(key_type k : keys){
+        t.insert(k, k);
+    }
+
+    unsigned long long checksum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(key_type k : queries){
+        value_type* found = t.find(k);
+        checksum += found ? *found : 1;
+    }
+    double scalar_seconds = seconds_since(start);
+    report(name, keys.size(), 1, queries.size(), scalar_seconds, scalar_seconds, checksum);
+
+    std::vector<value_type*> out;
+    for(size_t batch : opt.batches){
+        out.resize(batch);
+        checksum = 0;
+        start = bench_clock::now();
+        for(size_t i = 0; i < queries.size(); i += batch){
+            size_t n = std::min(batch, queries.size() - i);
+            t.lookup_batch(queries.data() + i, n, out.data());
+            for(size_t j = 0; j < n; j++){
+                checksum += out[j] ? *out[j] : 1;
+            }
+        }
+        report(name, keys.size(), batch, queries.size(), seconds_since(start), scalar_seconds, checksum);
+    }
+}
+
+static void run_size(size_t size, const options& opt){
+    using namespace cop3530;
+
+    //Keys are even so odd queries always miss
+    std::mt19937_64 gen(opt.seed + size);
+    std::vector<key_type> keys(size);
+    for(size_t i = 0; i < size; i++){
+        keys[i] = ((gen() & 0xffffffff00000000ull) | i) << 1; //Low bits make every key distinct
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    std::vector<key_type> queries(opt.queries);
+    for(size_t i = 0; i < opt.queries; i++){
+        key_type k = keys[gen() % size];
+        queries[i] = (i & 1) ? k | 1 : k;
+    }
+
+    run_tree<basic_AVL<key_type, value_type>>("AVL", keys, queries, opt);
+    run_tree<basic_BSTLEAF<key_type, value_type>>("BSTLEAF", keys, queries, opt);
+    run_tree<basic_BSTROOT<key_type, value_type>>("BSTROOT", keys, queries, opt);
+    run_tree<basic_BSTRAND<key_type, value_type>>("BSTRAND", keys, queries, opt);
+}
+
+template<typename number>
+static std::vector<number> parse_list(const char* p){
+    std::vector<number> values;
+    while(*p){
+        char* end;
+        values.push_back((number)strtoull(p, &end, 10));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.queries = 2000000;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--sizes=", 8) == 0){
+            opt.sizes = parse_list<size_t>(arg + 8);
+        }
+        else if(strncmp(arg, "--batches=", 10) == 0){
+            opt.batches = parse_list<size_t>(arg + 10);
+        }
+        else if(strncmp(arg, "--queries=", 10) == 0){
+            opt.queries = strtoull(arg + 10, nullptr, 10);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.sizes.empty()){
+        opt.sizes = {100000, 1000000};
+    }
+    if(opt.batches.empty()){
+        opt.batches = {16, 64, 512};
+    }
+    opt.batches.erase(std::remove(opt.batches.begin(), opt.batches.end(), (size_t)0), opt.batches.end());
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    printf("{\n  \"config\": {\"queries\": %zu, \"seed\": %llu},\n  \"results\": [", opt.queries, opt.seed);
+
+    for(size_t size : opt.sizes){
+        if(size > 0){
+            run_size(size, opt);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,533 @@
+//Benchmark for the four trees and BTREE with std::map as the baseline
+//Every tree runs sequential, reverse sorted, random, Zipf skewed and mixed read/write workloads at several sizes
+//Results go to stdout as one JSON object, so runs can be saved and diffed between releases
+//
+//Build and run (headers only, nothing else to link):
+//    g++ -O2 -std=c++17 -pthread BENCHMARK.cpp -o benchmark
+//    ./benchmark > results.json
+//
+//Add -mavx2 (or -march=native) to let BTREE search its nodes with AVX2 instead of SSE2
+//
+//Options:
+//    --sizes=1000,10000,100000   Tree sizes to run, default is those three
+//    --seed=N                    Seed for every random workload, default 12345
+//    --tree=NAME                 Only run trees whose name matches, e.g. --tree=AVL or --tree=std::map
+//    --workload=NAME             Only run one workload: sequential, reverse, random, zipf, mixed, comparator or stress
+//    --stress-size=N             Keys for the stress workload, default 10000000
+//
+//Each result is one timed phase of one workload. Latencies are measured per operation with steady_clock,
+//so they include the clock overhead reported in the config. peak_bytes is the most heap memory held
+//during the phase above what was held before the workload started, tracked by the operator new below.
+//retained_bytes is how much the phase itself grew (or shrank, if negative) the heap
+//
+//stress only runs when asked for with --workload=stress. It inserts --stress-size ascending keys, then copies
+//the tree and clears it. BSTROOT ends up as one path that deep, so copy and clear must not recurse per level
+//
+//comparator runs random inserts and then lookups on AVL with int and std::string keys, once through the original
+//compare/equals function pointers (the AVL alias, via function_compare) and once with basic_AVL's default
+//three_way_compare. String keys share a long prefix, so every comparison has to look past it. These results
+//have a comparator and key_type field instead of latencies and memory
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For malloc and free
+#include <cstddef> //For max_align_t
+#include <cstring> //For parsing options
+#include <new> //For replacing operator new
+#include <vector> //For workloads and latencies
+#include <algorithm> //For shuffling and sorting latencies
+#include <random> //For workload generation
+#include <cmath> //For Zipf weights
+#include <chrono> //For timing
+#include <string> //For option values
+#include <map> //Baseline
+#include "AVL.h"
+#include "BSTLEAF.h"
+#include "BSTROOT.h"
+#include "BSTRAND.h"
+#include "BTREE.h"
+
+//MEMORY TRACKING
+
+//Benchmark is single threaded, plain counters are enough
+static size_t live_bytes = 0; //Bytes currently allocated through operator new
+static size_t peak_bytes = 0; //Most bytes allocated at once since the last reset
+
+//GCC inlines these into container code and then flags the header arithmetic and the free of a new'd pointer,
+//both are fine since every block in the program comes from here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+//Every block gets a header holding its size, padded so the block keeps malloc's alignment
+static const size_t header_size = alignof(std::max_align_t);
+
+void* operator new(size_t n){
+    unsigned char* block = static_cast<unsigned char*>(malloc(n + header_size));
+    if(!block){
+        throw std::bad_alloc();
+    }
+
+    *reinterpret_cast<size_t*>(block) = n;
+    live_bytes += n;
+    if(live_bytes > peak_bytes){
+        peak_bytes = live_bytes;
+    }
+
+    return block + header_size;
+}
+
+void operator delete(void* p) noexcept{
+    if(!p){
+        return;
+    }
+
+    unsigned char* block = static_cast<unsigned char*>(p) - header_size;
+    live_bytes -= *reinterpret_cast<size_t*>(block);
+    free(block);
+}
+
+void* operator new[](size_t n){
+    return operator new(n);
+}
+
+void operator delete[](void* p) noexcept{
+    operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept{
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept{
+    operator delete(p);
+}
+
+//WORKLOADS
+
+enum op_type{ op_insert, op_lookup, op_remove, op_copy, op_clear };
+
+struct operation{
+    op_type type;
+    int key;
+};
+
+//A timed run of operations, setup operations are run first and not timed
+struct phase{
+    std::string name;
+    std::vector<operation> ops;
+};
+
+struct workload{
+    std::string name;
+    std::vector<operation> setup;
+    std::vector<phase> phases;
+};
+
+static std::vector<operation> make_ops(op_type type, const std::vector<int>& keys){
+    std::vector<operation> ops;
+    ops.reserve(keys.size());
+    for(int k : keys){
+        ops.push_back(operation{type, k});
+    }
+    return ops;
+}
+
+static std::vector<int> ascending(size_t n){
+    std::vector<int> keys(n);
+    for(size_t i = 0; i < n; i++){
+        keys[i] = (int)i;
+    }
+    return keys;
+}
+
+static std::vector<int> shuffled(size_t n, std::mt19937_64& gen){
+    std::vector<int> keys = ascending(n);
+    std::shuffle(keys.begin(), keys.end(), gen);
+    return keys;
+}
+
+//Draws n lookups where the i-th most popular key is picked with weight 1 / (i + 1)^s
+//Popularity ranks are shuffled so hot keys are spread over the whole tree, not packed at one end
+static std::vector<int> zipf_keys(size_t n, double s, std::mt19937_64& gen){
+    std::vector<double> cdf(n);
+    double total = 0;
+    for(size_t i = 0; i < n; i++){
+        total += 1.0 / std::pow((double)(i + 1), s);
+        cdf[i] = total;
+    }
+
+    std::vector<int> by_rank = shuffled(n, gen);
+    std::uniform_real_distribution<double> uniform(0, total);
+    std::vector<int> keys(n);
+    for(size_t i = 0; i < n; i++){
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(gen)) - cdf.begin();
+        if(rank >= n){
+            rank = n - 1;
+        }
+        keys[i] = by_rank[rank];
+    }
+    return keys;
+}
+
+static workload make_workload(const std::string& name, size_t n, unsigned long long seed){
+    std::mt19937_64 gen(seed);
+    workload w;
+    w.name = name;
+
+    if(name == "sequential"){
+        std::vector<int> keys = ascending(n);
+        w.phases.push_back(phase{"insert", make_ops(op_insert, keys)});
+        w.phases.push_back(phase{"lookup", make_ops(op_lookup, keys)});
+    }
+    else if(name == "reverse"){
+        std::vector<int> keys = ascending(n);
+        std::reverse(keys.begin(), keys.end());
+        w.phases.push_back(phase{"insert", make_ops(op_insert, keys)});
+        w.phases.push_back(phase{"lookup", make_ops(op_lookup, keys)});
+    }
+    else if(name == "random"){
+        w.phases.push_back(phase{"insert", make_ops(op_insert, shuffled(n, gen))});
+        w.phases.push_back(phase{"lookup", make_ops(op_lookup, shuffled(n, gen))});
+        w.phases.push_back(phase{"remove", make_ops(op_remove, shuffled(n, gen))});
+    }
+    else if(name == "zipf"){
+        w.setup = make_ops(op_insert, shuffled(n, gen));
+        w.phases.push_back(phase{"lookup", make_ops(op_lookup, zipf_keys(n, 0.99, gen))});
+    }
+    else if(name == "mixed"){
+        //Half the key space is filled, then 60% lookups, 20% inserts and 20% removes over the whole space
+        std::vector<int> keys = shuffled(n, gen);
+        keys.resize(n / 2);
+        w.setup = make_ops(op_insert, keys);
+
+        std::uniform_int_distribution<int> key_dist(0, (int)n - 1);
+        std::uniform_int_distribution<int> op_dist(0, 9);
+        std::vector<operation> ops;
+        ops.reserve(n);
+        for(size_t i = 0; i < n; i++){
+            int roll = op_dist(gen);
+            op_type type = roll < 6 ? op_lookup : (roll < 8 ? op_insert : op_remove);
+            ops.push_back(operation{type, key_dist(gen)});
+        }
+        w.phases.push_back(phase{"mixed", ops});
+    }
+    else if(name == "stress"){
+        //Copy makes a deep copy and frees it again, clear frees the tree itself
+        w.phases.push_back(phase{"insert", make_ops(op_insert, ascending(n))});
+        w.phases.push_back(phase{"copy", std::vector<operation>(1, operation{op_copy, 0})});
+        w.phases.push_back(phase{"clear", std::vector<operation>(1, operation{op_clear, 0})});
+    }
+
+    return w;
+}
+
+//TREE ADAPTERS
+
+//Same three operations for every tree, each returns whether it hit so the work can't be optimized away
+template<typename tree_type>
+struct tree_ops{
+    static bool insert(tree_type& t, int k){ return t.try_insert(k, k); }
+    static bool lookup(tree_type& t, int k){ return t.find(k) != nullptr; }
+    static bool remove(tree_type& t, int k){
+        //remove throws on a missing key, check first like a caller would
+        if(!t.contains(k)){
+            return false;
+        }
+        t.remove(k);
+        return true;
+    }
+    static bool copy(tree_type& t){ tree_type c(t); return c.size() == t.size(); }
+    static bool clear(tree_type& t){ t.clear(); return true; }
+    static long height(tree_type& t){ return t.height(); }
+};
+
+template<>
+struct tree_ops<std::map<int, int>>{
+    static bool insert(std::map<int, int>& t, int k){ return t.emplace(k, k).second; }
+    static bool lookup(std::map<int, int>& t, int k){ return t.find(k) != t.end(); }
+    static bool remove(std::map<int, int>& t, int k){ return t.erase(k) > 0; }
+    static bool copy(std::map<int, int>& t){ std::map<int, int> c(t); return c.size() == t.size(); }
+    static bool clear(std::map<int, int>& t){ t.clear(); return true; }
+    static long height(std::map<int, int>&){ return -1; } //Not exposed by std::map
+};
+
+//Original interface, compare and equals take keys by value
+static bool int_less(int a, int b){ return a < b; }
+static bool int_equal(int a, int b){ return a == b; }
+static bool string_less(std::string a, std::string b){ return a < b; }
+static bool string_equal(std::string a, std::string b){ return a == b; }
+
+//RUNNER
+
+struct options{
+    std::vector<size_t> sizes;
+    unsigned long long seed;
+    std::string tree_filter;
+    std::string workload_filter;
+    size_t stress_size;
+};
+
+static bool first_result = true;
+
+typedef std::chrono::steady_clock bench_clock;
+
+static long long elapsed_ns(bench_clock::time_point start, bench_clock::time_point stop){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+}
+
+static long long percentile(const std::vector<long long>& sorted, double p){
+    if(sorted.empty()){
+        return 0;
+    }
+    size_t i = (size_t)(p * (sorted.size() - 1));
+    return sorted[i];
+}
+
+template<typename tree_type>
+static bool apply(tree_type& t, const operation& op){
+    if(op.type == op_insert){
+        return tree_ops<tree_type>::insert(t, op.key);
+    }
+    if(op.type == op_lookup){
+        return tree_ops<tree_type>::lookup(t, op.key);
+    }
+    if(op.type == op_copy){
+        return tree_ops<tree_type>::copy(t);
+    }
+    if(op.type == op_clear){
+        return tree_ops<tree_type>::clear(t);
+    }
+    return tree_ops<tree_type>::remove(t, op.key);
+}
+
+static void print_skipped(const char* tree, const char* alloc, const workload& w, size_t n, const char* reason){
+    printf("%s\n    {\"tree\": \"%s\", \"allocator\": \"%s\", \"workload\": \"%s\", \"size\": %zu, \"skipped\": \"%s\"}",
+           first_result ? "" : ",", tree, alloc, w.name.c_str(), n, reason);
+    first_result = false;
+}
+
+template<typename tree_type>
+static void run_workload(const char* tree, const char* alloc, const workload& w, size_t n){
+    std::vector<long long> latencies;
+    size_t baseline = live_bytes;
+    tree_type t;
+
+    for(const operation& op : w.setup){
+        apply(t, op);
+    }
+
+    for(const phase& ph : w.phases){
+        latencies.assign(ph.ops.size(), 0);
+        size_t phase_baseline = live_bytes;
+        peak_bytes = live_bytes;
+        size_t hits = 0;
+
+        bench_clock::time_point phase_start = bench_clock::now();
+        for(size_t i = 0; i < ph.ops.size(); i++){
+            bench_clock::time_point start = bench_clock::now();
+            hits += apply(t, ph.ops[i]);
+            latencies[i] = elapsed_ns(start, bench_clock::now());
+        }
+        long long total_ns = elapsed_ns(phase_start, bench_clock::now());
+
+        //Latency buffer was already allocated before the phase, so it isn't counted
+        size_t peak = peak_bytes - baseline;
+        std::sort(latencies.begin(), latencies.end());
+        double seconds = total_ns / 1e9;
+
+        printf("%s\n    {\"tree\": \"%s\", \"allocator\": \"%s\", \"workload\": \"%s\", \"phase\": \"%s\", \"size\": %zu, "
+               "\"ops\": %zu, \"hits\": %zu, \"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+               "\"latency_ns\": {\"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"p999\": %lld, \"max\": %lld}, "
+               "\"peak_bytes\": %zu, \"retained_bytes\": %lld, \"height\": %ld}",
+               first_result ? "" : ",", tree, alloc, w.name.c_str(), ph.name.c_str(), n,
+               ph.ops.size(), hits, seconds, seconds > 0 ? ph.ops.size() / seconds : 0.0,
+               percentile(latencies, 0.50), percentile(latencies, 0.90), percentile(latencies, 0.99),
+               percentile(latencies, 0.999), latencies.empty() ? 0 : latencies.back(),
+               peak, (long long)live_bytes - (long long)phase_baseline, tree_ops<tree_type>::height(t));
+        first_result = false;
+    }
+}
+
+//sorted_limit caps sizes for sorted workloads on trees that go linear there, past it the
+//lookups (and for BSTLEAF the inserts too) walk most of the tree each time and a run takes hours
+//stress_limit does the same for the stress workload, which only has the inserts
+template<typename tree_type>
+static void run_tree(const char* tree, const char* alloc, const options& opt, size_t sorted_limit, size_t stress_limit){
+    if(!opt.tree_filter.empty() && opt.tree_filter != tree){
+        return;
+    }
+
+    //stress isn't in the default set, it needs the workload filter to run
+    const char* names[] = {"sequential", "reverse", "random", "zipf", "mixed", "stress"};
+    for(const char* name : names){
+        bool stress = strcmp(name, "stress") == 0;
+        if(opt.workload_filter.empty() ? stress : opt.workload_filter != name){
+            continue;
+        }
+
+        std::vector<size_t> sizes = opt.sizes;
+        if(stress){
+            sizes.assign(1, opt.stress_size);
+        }
+
+        for(size_t n : sizes){
+            workload w = make_workload(name, n, opt.seed);
+            bool sorted = w.name == "sequential" || w.name == "reverse";
+            if(sorted && n > sorted_limit){
+                print_skipped(tree, alloc, w, n, "degenerates to a list on sorted input");
+                continue;
+            }
+            if(stress && n > stress_limit){
+                print_skipped(tree, alloc, w, n, "sorted inserts are quadratic");
+                continue;
+            }
+            run_workload<tree_type>(tree, alloc, w, n);
+        }
+    }
+}
+
+//Times one tree over the given keys, inserts first and then lookups in a different order
+template<typename tree_type, typename key_type>
+static void run_comparator(const char* comparator, const char* key_name, const std::vector<key_type>& inserts, const std::vector<key_type>& lookups){
+    tree_type t;
+    const char* phases[] = {"insert", "lookup"};
+
+    for(const char* name : phases){
+        bool insert = strcmp(name, "insert") == 0;
+        const std::vector<key_type>& keys = insert ? inserts : lookups;
+        size_t hits = 0;
+
+        bench_clock::time_point start = bench_clock::now();
+        for(size_t i = 0; i < keys.size(); i++){
+            hits += insert ? t.try_insert(keys[i], (int)i) : t.find(keys[i]) != nullptr;
+        }
+        double seconds = elapsed_ns(start, bench_clock::now()) / 1e9;
+
+        printf("%s\n    {\"tree\": \"AVL\", \"allocator\": \"heap\", \"workload\": \"comparator\", \"comparator\": \"%s\", \"key_type\": \"%s\", "
+               "\"phase\": \"%s\", \"size\": %zu, \"ops\": %zu, \"hits\": %zu, \"seconds\": %.6f, \"ops_per_sec\": %.1f, \"ns_per_op\": %.2f}",
+               first_result ? "" : ",", comparator, key_name, name, inserts.size(), keys.size(), hits, seconds,
+               seconds > 0 ? keys.size() / seconds : 0.0, keys.empty() ? 0.0 : seconds * 1e9 / keys.size());
+        first_result = false;
+    }
+}
+
+static void run_comparators(const options& opt){
+    using namespace cop3530;
+
+    if(!opt.tree_filter.empty() && opt.tree_filter != "AVL"){
+        return;
+    }
+    if(!opt.workload_filter.empty() && opt.workload_filter != "comparator"){
+        return;
+    }
+
+    for(size_t n : opt.sizes){
+        std::mt19937_64 gen(opt.seed);
+        std::vector<int> int_inserts = shuffled(n, gen);
+        std::vector<int> int_lookups = shuffled(n, gen);
+
+        //Same keys as strings, zero padded behind a shared prefix so they sort like the ints
+        std::vector<std::string> string_inserts(n);
+        std::vector<std::string> string_lookups(n);
+        char buffer[64];
+        for(size_t i = 0; i < n; i++){
+            snprintf(buffer, sizeof(buffer), "sensor/region-07/counter-%010d", int_inserts[i]);
+            string_inserts[i] = buffer;
+            snprintf(buffer, sizeof(buffer), "sensor/region-07/counter-%010d", int_lookups[i]);
+            string_lookups[i] = buffer;
+        }
+
+        run_comparator<AVL<int, int, int_less, int_equal>>("function_compare", "int", int_inserts, int_lookups);
+        run_comparator<basic_AVL<int, int>>("three_way_compare", "int", int_inserts, int_lookups);
+        run_comparator<AVL<std::string, int, string_less, string_equal>>("function_compare", "std::string", string_inserts, string_lookups);
+        run_comparator<basic_AVL<std::string, int>>("three_way_compare", "std::string", string_inserts, string_lookups);
+    }
+}
+
+static long long timer_overhead(){
+    //Smallest gap between two back to back clock reads, subtract it mentally from the latencies
+    long long best = -1;
+    for(int i = 0; i < 1000; i++){
+        bench_clock::time_point a = bench_clock::now();
+        long long gap = elapsed_ns(a, bench_clock::now());
+        if(best < 0 || gap < best){
+            best = gap;
+        }
+    }
+    return best;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.seed = 12345;
+    opt.stress_size = 10000000;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--sizes=", 8) == 0){
+            const char* p = arg + 8;
+            while(*p){
+                char* end;
+                opt.sizes.push_back(strtoull(p, &end, 10));
+                if(*end != ','){
+                    break;
+                }
+                p = end + 1;
+            }
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else if(strncmp(arg, "--tree=", 7) == 0){
+            opt.tree_filter = arg + 7;
+        }
+        else if(strncmp(arg, "--workload=", 11) == 0){
+            opt.workload_filter = arg + 11;
+        }
+        else if(strncmp(arg, "--stress-size=", 14) == 0){
+            opt.stress_size = strtoull(arg + 14, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.sizes.empty()){
+        opt.sizes = {1000, 10000, 100000};
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    using namespace cop3530;
+    typedef three_way_compare<int> int_compare;
+    const size_t unlimited = (size_t)-1;
+
+    options opt = parse_options(argc, argv);
+
+    printf("{\n  \"config\": {\"seed\": %llu, \"timer_overhead_ns\": %lld, \"stress_size\": %zu, \"sizes\": [", opt.seed, timer_overhead(), opt.stress_size);
+    for(size_t i = 0; i < opt.sizes.size(); i++){
+        printf("%s%zu", i ? ", " : "", opt.sizes[i]);
+    }
+    printf("]},\n  \"results\": [");
+
+    run_tree<std::map<int, int>>("std::map", "std", opt, unlimited, unlimited);
+    run_tree<basic_AVL<int, int>>("AVL", "heap", opt, unlimited, unlimited);
+    run_tree<basic_AVL<int, int, int_compare, pool_allocator>>("AVL", "pool", opt, unlimited, unlimited);
+    run_tree<basic_BSTLEAF<int, int>>("BSTLEAF", "heap", opt, 10000, 50000);
+    run_tree<basic_BSTLEAF<int, int, int_compare, pool_allocator>>("BSTLEAF", "pool", opt, 10000, 50000);
+    run_tree<basic_BSTROOT<int, int>>("BSTROOT", "heap", opt, 10000, unlimited);
+    run_tree<basic_BSTROOT<int, int, int_compare, pool_allocator>>("BSTROOT", "pool", opt, 10000, unlimited);
+    run_tree<basic_BSTRAND<int, int>>("BSTRAND", "heap", opt, unlimited, unlimited);
+    run_tree<basic_BSTRAND<int, int, int_compare, pool_allocator>>("BSTRAND", "pool", opt, unlimited, unlimited);
+    run_tree<basic_BTREE<int, int>>("BTREE", "heap", opt, unlimited, unlimited);
+    run_tree<basic_BTREE<int, int, int_compare, pool_allocator>>("BTREE", "pool", opt, unlimited, unlimited);
+    run_comparators(opt);
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -3,13 +3,32 @@
 
 #include <iostream> //For size_t and other things
 #include <stdexcept> //For exceptions
+#include <vector> //For iterator paths
+#include <utility> //For std::forward, std::move and std::swap
+#include <type_traits> //For checking how a value can be assigned
+#include "NODEPOOL.h" //For node allocators
+#include "COMPARATOR.h" //For key comparators
+#include "STATS.h" //For operation counters
+#include "SHAPE.h" //For shape reports
+#include "FROZEN.h" //For read-only snapshots
+#include "SNAPSHOT.h" //For saving to and loading from files
+#include <cstdint> //For PRNG state
 
 namespace cop3530{
 
+    //How lookups in BSTROOT reshape the tree around the key they find. Misses never change anything
+    enum class access_mode{
+        fixed, //Lookups only read, the default
+        splay, //Found node is splayed all the way to the root, so hot keys stay near the top. Every hit rewrites its whole path
+        semi_splay, //Found node moves about halfway up, with about half the rotations of splay. Hot keys still rise, over a few hits
+        sampled_splay //Full splay on a random one in n hits, the rest only read. Hot keys get splayed often, cold ones rarely
+    };
+
     //BST for inserting at root
-    //Only change is in insert, must rotate each time we move down in recursive call
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    class BSTROOT{
+    //Only change is in insert, the tree is split around the new key on the way down so it lands at the root
+    //Lookups can also move the key they find toward the root, see access_mode and adapt_on_access
+    template<typename key_type, typename value_type, typename comparator = three_way_compare<key_type>, template<typename> class allocator = heap_allocator, typename stats_policy = no_stats>
+    class basic_BSTROOT{
 
     private:
 
@@ -18,56 +37,229 @@ namespace cop3530{
             value_type value;
             node* left;
             node* right;
+            size_t count; //Number of nodes in the subtree rooted here
+
+            //Builds key and value in place from the insert arguments, new node is always a leaf
+            template<typename key_arg, typename... value_args>
+            node(key_arg&& k, value_args&&... args) : key(std::forward<key_arg>(k)), value(std::forward<value_args>(args)...), left(nullptr), right(nullptr), count(1) {}
         };
 
         node* root;
-        size_t get_size(node* curr); //Function to recursively get amount of key-value pairs
-        void insert_at_root(node*& curr, key_type k, value_type v); //Recursively inserts k-v pair
-        node* do_delete(node* curr, key_type k); //Removes node using recursion to fix tree
-        void deletion(node* curr); //Helps the clear function. Deletes recursively
-        int get_height(node* curr); //Helps height function, recursively calls for height on nodes
-        void rotate_left(node*& curr); //Used during insertion, rotates subtree counterclockwise
-        void rotate_right(node*& curr); //Used during insertion, rotates subtree clockwise
-        void recursive_copy(node*& curr); //Used for deep copy constructor, adds k-v pairs from other bst
+        allocator<node> alloc; //Hands out and takes back every node in the tree
+        stats_policy counters; //Told about every comparison, rotation, lookup step, allocation and free, no_stats ignores them
+        access_mode mode; //How lookups reshape the tree
+        size_t sample_rate; //sampled_splay splays one hit in this many, on average
+        uint64_t rng_state; //Picks the hits sampled_splay splays
+        std::vector<node*> access_path; //Root to the found node, kept between lookups so adapting ones don't allocate
+        std::vector<std::pair<node*, bool>> put_path; //Nodes put went down through and whether it went left at each, kept so inserts don't allocate
+        template<typename key_like> int compare_keys(const key_like& a, const key_type& b); //One three-way comparison, negative if a < b, 0 if equal
+        size_t get_size(node* curr); //Returns cached size of a subtree, 0 for nullptr
+        template<typename key_like> node* locate(const key_like& k, size_t& below); //Returns node holding k, or nullptr with the path to it in put_path and how many keys are less than k
+        void insert_at_root(node*& curr, node* fresh, size_t below); //Makes fresh the root by splitting the tree along put_path, fresh's key must be new
+        node* do_delete(node* curr, const key_type& k); //Removes a key that is in the subtree, in one loop down
+        void deletion(node* curr); //Helps the clear function. Frees a subtree in a loop, no recursion
+        int get_height(node* curr); //Helps height function, walks the subtree with an explicit stack
+        void update_node(node* curr); //Recomputes cached size of a node from its children
+        size_t count_less(const key_type& k, bool inclusive); //Counts keys smaller than (or equal to, if inclusive) k
+        node* copy_subtree(const node* curr); //Used for deep copy, clones a subtree node by node keeping its shape
+        template<typename pair_iterator> node* build_balanced(pair_iterator& curr, size_t n); //Builds a balanced subtree from the next n sorted pairs
+        template<typename key_arg, typename... value_args> bool put(key_arg&& k, bool assign, value_args&&... args); //Single descent insert shared by the public inserts
+        template<typename value_arg> static void assign_value(value_type& target, value_arg&& v); //Overwrites a value from a single insert argument
+        template<typename... value_args> static void assign_value(value_type& target, value_args&&... args); //Overwrites a value built from several insert arguments
+        template<typename key_like> node* find_node(const key_like& k); //Returns node holding key, nullptr if missing
+        static const size_t batch_lanes = 16; //Descents the batch lookups keep going at once
+        static void prefetch(const void* p); //Hint to start loading a cache line, does nothing where the builtin isn't there
+        template<typename visit> void find_nodes(const key_type* keys, size_t n, visit found); //Interleaved descents, calls found(i, node) for every key, node is nullptr if missing
+        template<typename key_like> node* access_node(const key_like& k); //Same as find_node, but records the path and reshapes it around the found node as mode says
+        node* rotate_up(node* parent, node* child); //Rotates child above parent and returns it, sizes of both are fixed
+        node** link_to(size_t depth); //Link that holds access_path[depth], root or a child pointer of the node above it
+        void splay(size_t depth, bool semi); //Moves access_path[depth] to the root, or about halfway there if semi
+        uint64_t next_random(); //Next number from the tree's generator (splitmix64)
 
     public:
-        BSTROOT();
-        BSTROOT(const BSTROOT& b); //copy constructor
-        BSTROOT& operator=(const BSTROOT& b); //Copy assignment operator
-        BSTROOT(BSTROOT&& b); //Move constructor
-        BSTROOT& operator=(BSTROOT&& b); //Move-assignment operator
-        ~BSTROOT();
-
-        void insert(key_type k, value_type v); //Adds k-v pair to map
-        void remove(key_type k); //Removes k-v pair from map
-        value_type& lookup(key_type k); //Returns a reference to the value associated with given key
-
-        bool contains(key_type k); //Returns true if tree contains value associated with key
+        //Key-value pair handed out by iterators, key is const so tree order can't be broken
+        struct entry{
+            const key_type& key;
+            value_type& value;
+        };
+
+        //Bidirectional in-order iterator. Keeps the path from root to its node instead of parent pointers,
+        //so ++ and -- are amortized O(1). Any insert or remove invalidates every iterator
+        class iterator{
+
+        private:
+            friend class basic_BSTROOT;
+
+            //Lets it->key and it->value work even though entries are made on the fly
+            struct arrow{
+                entry e;
+                entry* operator->(){ return &e; }
+            };
+
+            node* root; //Needed so --end() can find the largest key
+            std::vector<node*> path; //Root to current node, empty means end()
+
+            iterator(node* r) : root(r) {}
+
+            //Pushes curr and then keeps going to one side until the bottom
+            void push_leftmost(node* curr){
+                while(curr){
+                    path.push_back(curr);
+                    curr = curr->left;
+                }
+            }
+
+            void push_rightmost(node* curr){
+                while(curr){
+                    path.push_back(curr);
+                    curr = curr->right;
+                }
+            }
+
+        public:
+            iterator() : root(nullptr) {}
+
+            entry operator*() const{ return entry{path.back()->key, path.back()->value}; }
+            arrow operator->() const{ return arrow{**this}; }
+
+            iterator& operator++(){
+                node* curr = path.back();
+
+                //Next key is smallest one in right subtree
+                if(curr->right){
+                    push_leftmost(curr->right);
+                    return *this;
+                }
+
+                //Otherwise climb until we come up from a left child, that parent is next
+                path.pop_back();
+                while(!path.empty() && path.back()->right == curr){
+                    curr = path.back();
+                    path.pop_back();
+                }
+                return *this;
+            }
+
+            iterator& operator--(){
+                //Stepping back from end() lands on the largest key
+                if(path.empty()){
+                    push_rightmost(root);
+                    return *this;
+                }
+
+                node* curr = path.back();
+
+                //Previous key is largest one in left subtree
+                if(curr->left){
+                    push_rightmost(curr->left);
+                    return *this;
+                }
+
+                //Otherwise climb until we come up from a right child, that parent is previous
+                path.pop_back();
+                while(!path.empty() && path.back()->left == curr){
+                    curr = path.back();
+                    path.pop_back();
+                }
+                return *this;
+            }
+
+            iterator operator++(int){ iterator temp = *this; ++*this; return temp; }
+            iterator operator--(int){ iterator temp = *this; --*this; return temp; }
+
+            bool operator==(const iterator& b) const{
+                //Both at end, or both on the same node
+                if(path.empty() || b.path.empty()){
+                    return path.empty() && b.path.empty();
+                }
+                return path.back() == b.path.back();
+            }
+
+            bool operator!=(const iterator& b) const{ return !(*this == b); }
+        };
+
+        basic_BSTROOT();
+        basic_BSTROOT(const basic_BSTROOT& b); //copy constructor
+        basic_BSTROOT& operator=(const basic_BSTROOT& b); //Copy assignment operator
+        basic_BSTROOT(basic_BSTROOT&& b); //Move constructor
+        basic_BSTROOT& operator=(basic_BSTROOT&& b); //Move-assignment operator
+        ~basic_BSTROOT();
+
+        void insert(const key_type& k, const value_type& v); //Adds k-v pair to map
+        bool try_insert(const key_type& k, const value_type& v); //Adds k-v pair if key is new, returns true if it was added
+        bool insert_or_assign(const key_type& k, const value_type& v); //Adds k-v pair or overwrites existing value, returns true if it was added
+        void insert(key_type&& k, value_type&& v); //Same as above, but key and value are moved into the node
+        bool try_insert(key_type&& k, value_type&& v);
+        bool insert_or_assign(key_type&& k, value_type&& v);
+        template<typename... value_args> bool emplace(const key_type& k, value_args&&... args); //Builds value in place from args if key is new, returns true if it was added
+        template<typename... value_args> bool emplace(key_type&& k, value_args&&... args);
+        void remove(const key_type& k); //Removes k-v pair from map
+        value_type& lookup(const key_type& k); //Returns a reference to the value associated with given key
+        value_type* find(const key_type& k); //Returns a pointer to the value associated with given key, nullptr if missing
+        value_type lookup_or(const key_type& k, const value_type& fallback); //Returns the value associated with given key, fallback if missing
+
+        //Lookups by any type the comparator can compare against a key, only there if comparator has is_transparent
+        template<typename key_like, typename key_comparator = comparator, typename transparent = typename key_comparator::is_transparent> value_type& lookup(const key_like& k);
+        template<typename key_like, typename key_comparator = comparator, typename transparent = typename key_comparator::is_transparent> value_type* find(const key_like& k);
+        template<typename key_like, typename key_comparator = comparator, typename transparent = typename key_comparator::is_transparent> bool contains(const key_like& k);
+
+        bool contains(const key_type& k); //Returns true if tree contains value associated with key
+        void lookup_batch(const key_type* keys, size_t n, value_type** out); //Points out[i] at the value for keys[i], nullptr if missing. Walks several keys at once so their cache misses overlap
+        void contains_batch(const key_type* keys, size_t n, bool* out); //Sets out[i] to whether keys[i] is in the map, same walk as lookup_batch
         bool is_empty(); //Returns true if tree is empty
         bool is_full(); //Returns true if no more pairs can be added to map
         size_t size(); //Returns all key value pairs in map
         void clear(); //Removes all elements from map
         int height(); //Returns tree's height
         int balance(); //Returns tree's balance factor
+        void adapt_on_access(access_mode m, size_t one_in = 8); //Sets how lookups reshape the tree, one_in is only used by sampled_splay. Any mode but fixed makes lookups invalidate iterators
+        access_mode adapting(); //Returns the mode set by adapt_on_access
+        tree_shape<key_type> shape_report(size_t worst = 8); //Depth histograms, path lengths and the worst most imbalanced subtrees, in one pass
+        tree_stats stats(); //Returns the counters so far, all 0 unless stats_policy is count_stats
+        void reset_stats(); //Sets every counter back to 0
+
+        const key_type& select(size_t i); //Returns the i-th smallest key, starting from 0
+        size_t rank(const key_type& k); //Returns how many keys are smaller than k
+        size_t count_in_range(const key_type& lo, const key_type& hi); //Returns how many keys are in [lo, hi]
+
+        template<typename pair_iterator> void build_from_sorted(pair_iterator first, pair_iterator last); //Replaces map with sorted (key, value) pairs in linear time
+        basic_FROZEN<key_type, value_type, comparator> freeze(); //Copies every pair into a read-only map laid out for fast lookups, later changes here don't show up in it
+        void save(const std::string& path); //Writes every pair to a snapshot file, keys and values must be trivially copyable
+        void load(const std::string& path); //Replaces map with the pairs of a snapshot file in linear time, nothing changes if the file is bad
+
+        iterator begin(); //Iterator to smallest key
+        iterator end(); //Iterator past the largest key
+        iterator lower_bound(const key_type& k); //Iterator to first key not less than k
+        iterator upper_bound(const key_type& k); //Iterator to first key greater than k
+        iterator floor(const key_type& k); //Iterator to largest key not greater than k, end() if none
+        iterator ceiling(const key_type& k); //Iterator to smallest key not less than k, end() if none
     };
 
+    //Original interface, ordering comes from a pair of compare and equals functions
+    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type), template<typename> class allocator = heap_allocator, typename stats_policy = no_stats>
+    using BSTROOT = basic_BSTROOT<key_type, value_type, function_compare<key_type, compare, equals>, allocator, stats_policy>;
+
     //CONSTRUCTORS AND DESTRUCTORS
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    BSTROOT<key_type, value_type, compare, equals> :: BSTROOT(){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: basic_BSTROOT(){
         root = nullptr;
+        mode = access_mode::fixed;
+        sample_rate = 8;
+        rng_state = 0; //Fixed seed, sampling only has to be spread out, not unpredictable
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    BSTROOT<key_type, value_type, compare, equals> :: BSTROOT(const BSTROOT& b){ //Deep copy constructor
-        root = nullptr;
-
-        node* curr = b.root;
-        recursive_copy(curr);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: basic_BSTROOT(const basic_BSTROOT& b){ //Deep copy constructor
+        //Clone nodes directly instead of reinserting, so shape and cached fields carry over
+        root = copy_subtree(b.root);
+        mode = b.mode;
+        sample_rate = b.sample_rate;
+        rng_state = b.rng_state;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    BSTROOT<key_type, value_type, compare, equals>& BSTROOT<key_type, value_type, compare, equals> :: operator=(const BSTROOT& b){ //Copy assignment operator
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy>& basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: operator=(const basic_BSTROOT& b){ //Copy assignment operator
         //Check that this and given BST arent the same
         if(this == &b){
             return *this;
@@ -75,21 +267,26 @@ namespace cop3530{
 
         //Else, clear the tree and add a deep copy of given BST
         clear();
-
-        node* curr = b.root;
-        recursive_copy(curr);
+        root = copy_subtree(b.root);
+        mode = b.mode;
+        sample_rate = b.sample_rate;
+        rng_state = b.rng_state;
         return *this;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    BSTROOT<key_type, value_type, compare, equals> :: BSTROOT(BSTROOT&& b){ //Move constructor
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: basic_BSTROOT(basic_BSTROOT&& b){ //Move constructor
         //Creates a shallow copy and sets root of given BST to nullptr
         root = b.root;
         b.root = nullptr;
+        alloc.swap(b.alloc); //Nodes stay in the pool they came from, so the pool moves with them
+        mode = b.mode;
+        sample_rate = b.sample_rate;
+        rng_state = b.rng_state;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    BSTROOT<key_type, value_type, compare, equals>& BSTROOT<key_type, value_type, compare, equals> :: operator=(BSTROOT&& b){ //Move assignment operator
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy>& basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: operator=(basic_BSTROOT&& b){ //Move assignment operator
         //Check that this and given BST arent the same
         if(this == &b){
             return *this;
@@ -99,221 +296,370 @@ namespace cop3530{
         clear();
         root = b.root;
         b.root = nullptr;
+        alloc.swap(b.alloc); //Nodes stay in the pool they came from, so the pool moves with them
+        mode = b.mode;
+        sample_rate = b.sample_rate;
+        rng_state = b.rng_state;
         return *this;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    BSTROOT<key_type, value_type, compare, equals> :: ~BSTROOT(){
-        //To destroy BST, clear it and get rid of root
-        deletion(root);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: ~basic_BSTROOT(){
+        //To destroy BST, free every node unless the allocator can drop them all at once
+        if(!allocator<node>::bulk_release){
+            deletion(root);
+        }
     }
 
     //HELPER FUNCTIONS
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void BSTROOT<key_type, value_type, compare, equals> :: recursive_copy(node*& curr){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename key_like>
+    int basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: compare_keys(const key_like& a, const key_type& b){
+        //Comparator is stateless, so a temporary is free and the call can be inlined
+        counters.compared();
+        return comparator()(a, b);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: node* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: copy_subtree(const node* curr){
+        //Clones a subtree keeping its shape and cached fields. Uses an explicit stack of (original, slot for its copy)
+        //instead of recursion, so a tree shaped like a list can't overflow the call stack
+        node* result = nullptr;
+        std::vector<std::pair<const node*, node**>> pending;
         if(curr){
-            insert(curr->key, curr->value);
+            pending.push_back(std::make_pair(curr, &result));
         }
 
-        if(curr->left){
-            recursive_copy(curr->left);
+        //Copies are linked in as soon as they are made, so if anything throws part way the copy so far is a real tree to free
+        try{
+            while(!pending.empty()){
+                const node* from = pending.back().first;
+                node** slot = pending.back().second;
+                pending.pop_back();
+
+                node* copy = alloc.allocate(*from);
+                counters.allocated();
+                copy->left = nullptr;
+                copy->right = nullptr;
+                *slot = copy;
+
+                if(from->right){
+                    pending.push_back(std::make_pair(from->right, &copy->right));
+                }
+                if(from->left){
+                    pending.push_back(std::make_pair(from->left, &copy->left));
+                }
+            }
         }
-        if(curr->right){
-            recursive_copy(curr->right);
+        catch(...){
+            deletion(result);
+            throw;
         }
+
+        return result;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    size_t BSTROOT<key_type, value_type, compare, equals> :: get_size(node* curr){
-        //Recursively goes through counting number of nodes
-        //Case if node we are on doesn't exist
-        if(!curr){
-            return 0;
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename pair_iterator>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: node* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: build_balanced(pair_iterator& curr, size_t n){
+        //Left half, then middle pair, then right half, so pairs are consumed in order
+        //Halves differ in size by at most 1, which keeps the subtree perfectly balanced
+        if(n == 0){
+            return nullptr;
         }
-        //Case where we reached bottom of tree, count 1
-        if(!curr->left && !curr->right){
-            return 1;
-        }
-        //Return left side + right + 1 to account for itself
-        return get_size(curr->left) + get_size(curr->right) + 1;
-    }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    int BSTROOT<key_type, value_type, compare, equals> :: get_height(node* curr){
-        //Gets max height of left and right size, returns max
-        int left_max = 1;
-        int right_max = 1;
+        node* left = build_balanced(curr, n / 2);
+
+        node* middle = alloc.allocate(curr->first, curr->second);
+        counters.allocated();
+        ++curr;
 
-        //Case we are on node that does not exist
+        middle->left = left;
+        middle->right = build_balanced(curr, n - n / 2 - 1);
+        update_node(middle);
+        return middle;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    size_t basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: get_size(node* curr){
+        //Sizes are cached in each node, so this is constant time
         if(!curr){
             return 0;
         }
-        //Bottom of tree, add 1 and work our way up
-        if(!curr->left && !curr->right){
-            return 1;
+
+        return curr->count;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    int basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: get_height(node* curr){
+        //Deepest level, found depth first with an explicit stack of (node, its depth) so long paths can't overflow the call stack
+        int deepest = 0;
+        std::vector<std::pair<node*, int>> pending;
+        if(curr){
+            pending.push_back(std::make_pair(curr, 1));
         }
 
-        //Keep adding to specific side and work recursively
-        left_max += get_height(curr->left);
-        right_max += get_height(curr->right);
+        while(!pending.empty()){
+            node* at = pending.back().first;
+            int depth = pending.back().second;
+            pending.pop_back();
 
-        //Return the side with most items
-        if(left_max > right_max){
-            return left_max;
+            if(depth > deepest){
+                deepest = depth;
+            }
+            if(at->left){
+                pending.push_back(std::make_pair(at->left, depth + 1));
+            }
+            if(at->right){
+                pending.push_back(std::make_pair(at->right, depth + 1));
+            }
         }
 
-        return right_max;
+        return deepest;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void BSTROOT<key_type, value_type, compare, equals> :: deletion(node* curr){
-        //Deletion goes to bottom of tree and works its way up, deleting each node on the way and setting children to nullptr
-        if(curr){
-            deletion(curr->left);
-            deletion(curr->right);
-            delete curr;
-        }
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: update_node(node* curr){
+        //Size is both children plus itself, children must already be up to date
+        curr->count = get_size(curr->left) + get_size(curr->right) + 1;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    typename BSTROOT<key_type, value_type, compare, equals> :: node* BSTROOT<key_type, value_type, compare, equals> :: do_delete(node* curr, key_type k){
-        //Removing, this means we have a match and curr is on node we have to remove
-        if(equals(k, curr->key)){
-            //Case 1: no children, just delete curr and set to nullptr for parent
-            if(!curr->left && !curr->right){
-                delete curr;
-                curr = nullptr;
-            }
-            //Case 2: One child. Simply delete and return right child so parent has that child
-            else if(!curr->left){
-                node* temp = curr;
-                curr = curr->right;
-                delete temp;
-            }
-            //Case 2 but for other child
-            else if(!curr->right){
-                node* temp = curr;
-                curr = curr->left;
-                delete temp;
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: deletion(node* curr){
+        //Rotates left children up until the node on top has none, then frees it and moves on to its right child
+        //Each node is rotated at most once and freed once with no stack at all, so any shape is O(n) time and O(1) space
+        while(curr){
+            if(curr->left){
+                node* temp = curr->left;
+                curr->left = temp->right;
+                temp->right = curr;
+                curr = temp;
             }
-            //Case 3: 2 children from deletion node
             else{
-                //Get the in-order successor
                 node* temp = curr->right;
-                while(temp->left){
-                    temp = temp->left;
-                }
+                alloc.deallocate(curr);
+                counters.freed();
+                curr = temp;
+            }
+        }
+    }
 
-                //Swap in order successor's values with deletion node's
-                curr->key = temp->key;
-                curr->value = temp->value;
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: node* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: do_delete(node* curr, const key_type& k){
+        //Key must be in the subtree, remove checks first. Every node above it loses one, so sizes are fixed on the way down
+        node** link = &curr;
+        while(true){
+            node* at = *link;
+            int order = compare_keys(k, at->key); //One comparison picks the branch
+            if(order == 0){
+                break;
+            }
 
-                //Keep working in order to fix tree
-                curr->right = do_delete(curr->right, temp->key);
+            at->count--;
+
+            //Key comes before node we are currently on, so go left
+            if(order < 0){
+                link = &at->left;
+            }
+            //Key greater than, go right
+            else{
+                link = &at->right;
             }
         }
-        //Key comes before node we are currently on, so go left
-        else if(compare(k, curr->key)){
-            curr->left = do_delete(curr->left, k);
+
+        node* temp = *link;
+
+        //Case 1 and 2: no children or one child, the child (or nullptr) takes the removed node's place
+        if(!temp->left){
+            *link = temp->right;
+            alloc.deallocate(temp);
+            counters.freed();
+        }
+        else if(!temp->right){
+            *link = temp->left;
+            alloc.deallocate(temp);
+            counters.freed();
         }
-        //Key greater than, go right
+        //Case 3: 2 children, the in-order successor is unlinked instead and its key and value move up
         else{
-            curr->right = do_delete(curr->right, k);
+            temp->count--;
+            node** successor = &temp->right;
+            while((*successor)->left){
+                (*successor)->count--;
+                successor = &(*successor)->left;
+            }
+
+            //Successor has no left child, its right one takes its place
+            node* gone = *successor;
+            *successor = gone->right;
+
+            //Swapping means nothing is copied, the removed key and value are freed with gone
+            std::swap(temp->key, gone->key);
+            std::swap(temp->value, gone->value);
+            alloc.deallocate(gone);
+            counters.freed();
         }
 
-        //Return node to keep track of children
         return curr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void BSTROOT<key_type, value_type, compare, equals> :: rotate_left(node*& curr){
-        //Rotate's counter clockwise using process shown in class
-        node* temp = curr->right;
-        curr->right = temp->left;
-        temp->left = curr;
-        curr = temp;
-    }
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename key_like>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: node* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: locate(const key_like& k, size_t& below){
+        //Same walk as count_less, but stops on a match instead of counting past it
+        //Every node passed goes on put_path, so a new key's insert can follow the path again without comparing
+        below = 0;
+        put_path.clear();
+        node* curr = root;
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void BSTROOT<key_type, value_type, compare, equals> :: rotate_right(node*& curr){
-        //Rotate's clockwise using process shown in class
-        node* temp = curr->left;
-        curr->left = temp->right;
-        temp->right = curr;
-        curr = temp;
+        while(curr){
+            int order = compare_keys(k, curr->key); //One comparison picks the branch
+            if(order == 0){
+                return curr;
+            }
+
+            put_path.push_back(std::make_pair(curr, order < 0));
+            if(order < 0){
+                curr = curr->left;
+            }
+            else{
+                below += get_size(curr->left) + 1;
+                curr = curr->right;
+            }
+        }
+
+        return nullptr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void BSTROOT<key_type, value_type, compare, equals> :: insert_at_root(node*& curr, key_type k, value_type v){
-        //Since we are inserting at root, we have base case here. Here we insert at a leaf, but rotate up from recursive calls
-        if(!curr){
-            node* insertion = new node;
-            insertion->key = k;
-            insertion->value = v;
-            curr = insertion;
-            curr->left = nullptr;
-            curr->right = nullptr;
-        }
-        //Key is less than current node, go left and rotate right
-        else if(compare(k, curr->key)){
-            insert_at_root(curr->left, k, v);
-            rotate_right(curr);
-        }
-        //Go right and rotate left
-        else{
-            insert_at_root(curr->right, k, v);
-            rotate_left(curr);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: insert_at_root(node*& curr, node* fresh, size_t below){
+        //Top down split: nodes less than fresh are hung off its left side in the order we meet them, the rest off its right
+        //Gives the same tree as inserting at a leaf and rotating up. The split follows the path locate took, so it compares nothing
+        //below is how many keys in the tree are less than fresh's, which gives every moved node its new size right away
+        size_t total = get_size(curr);
+        node** less = &fresh->left;
+        node** greater = &fresh->right;
+
+        for(size_t depth = 0; depth < put_path.size(); depth++){
+            node* at = put_path[depth].first;
+
+            //Node and its right subtree are all greater, only its left subtree still needs splitting
+            if(put_path[depth].second){
+                at->count -= below;
+                *greater = at;
+                greater = &at->left;
+            }
+            //Node and its left subtree are all less, only its right subtree still needs splitting
+            else{
+                size_t left_size = get_size(at->left);
+                at->count = below;
+                *less = at;
+                less = &at->right;
+                below -= left_size + 1;
+            }
         }
+
+        *less = nullptr;
+        *greater = nullptr;
+        fresh->count = total + 1;
+        curr = fresh;
     }
 
-    //PUBLIC FUNCTIONS
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    size_t basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: count_less(const key_type& k, bool inclusive){
+        //Walks down once, adding the left subtree and node itself every time we go right
+        size_t total = 0;
+        node* curr = root;
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void BSTROOT<key_type, value_type, compare, equals> :: insert(key_type k, value_type v){
-        //If tree empty, just insert at root, otherwise check if key already used and recursively insert k-v pair
-        if(is_empty()){
-            root = new node;
-            root->key = k;
-            root->value = v;
-            root->left = nullptr;
-            root->right = nullptr;
-            return;
+        while(curr){
+            int order = compare_keys(k, curr->key); //One comparison picks the branch
+            if(order == 0){
+                //Everything in left subtree is smaller, node itself counts only if inclusive
+                total += get_size(curr->left);
+                if(inclusive){
+                    total++;
+                }
+                return total;
+            }
+            else if(order < 0){
+                curr = curr->left;
+            }
+            else{
+                total += get_size(curr->left) + 1;
+                curr = curr->right;
+            }
         }
 
-        if(contains(k)){
-            throw std::runtime_error("Already contain that key");
+        return total;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename key_arg, typename... value_args>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: put(key_arg&& k, bool assign, value_args&&... args){
+        //Only walk that compares keys, finds k or else the path to where it goes and how many keys are less than it
+        size_t below;
+        node* found = locate(k, below);
+
+        //Key already in map, overwrite only if asked to and leave tree shape alone
+        if(found){
+            if(assign){
+                assign_value(found->value, std::forward<value_args>(args)...);
+            }
+            return false;
         }
 
-        insert_at_root(root, k, v);
+        //Node is made before anything changes, so a throw leaves the tree as it was
+        node* fresh = alloc.allocate(std::forward<key_arg>(k), std::forward<value_args>(args)...); //Key and value are built right in the node
+        counters.allocated();
+        insert_at_root(root, fresh, below);
+        return true;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void BSTROOT<key_type, value_type, compare, equals> :: remove(key_type k){
-        //Check if empty to avoid errors, then call recursive function to remove
-        if(is_empty()){
-            throw std::runtime_error("Cannot remove from an empty map");
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename value_arg>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: assign_value(value_type& target, value_arg&& v){
+        //Assign straight over the old value when possible, so a copy can reuse its storage
+        //Otherwise (say an explicit conversion) build a new value and move it in
+        if constexpr(std::is_assignable<value_type&, value_arg&&>::value){
+            target = std::forward<value_arg>(v);
         }
+        else{
+            target = value_type(std::forward<value_arg>(v));
+        }
+    }
 
-        do_delete(root, k);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename... value_args>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: assign_value(value_type& target, value_args&&... args){
+        //Several arguments only come from emplace, build the value and move it in
+        target = value_type(std::forward<value_args>(args)...);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    value_type& BSTROOT<key_type, value_type, compare, equals> :: lookup(key_type k){
-        //Again check if empty and then go through tree looking for key
-        if(is_empty()){
-            throw std::runtime_error("Cannot lookup in an empty map");
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename key_like>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: node* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: find_node(const key_like& k){
+        //Plain descent, shared by every lookup so transparent keys walk the tree the same way
+        //Adapting lookups take the walk that remembers its path, sampled_splay only for the lookups it picks
+        if(mode == access_mode::splay || mode == access_mode::semi_splay){
+            return access_node(k);
+        }
+        if(mode == access_mode::sampled_splay && next_random() % sample_rate == 0){
+            return access_node(k);
         }
 
         node* curr = root;
+        counters.looked_up();
 
         while(curr){
+            counters.visited();
+            int order = compare_keys(k, curr->key); //One comparison picks the branch
             //Key matched node we are on
-            if(equals(k, curr->key)){
-                return curr->value;
+            if(order == 0){
+                return curr;
             }
             //Key comes before node we are on, go left
-            else if(compare(k, curr->key)){
+            else if(order < 0){
                 curr = curr->left;
             }
             //Go right
@@ -322,35 +668,376 @@ namespace cop3530{
             }
         }
 
-        //No key was found, return error
-        throw std::runtime_error("Given key was not in the map to remove");
+        return nullptr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    bool BSTROOT<key_type, value_type, compare, equals> :: contains(key_type k){
-        //Same as lookup, just returning bool instead of value
-        if(is_empty()){
-            return false;
-        }
-
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename key_like>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: node* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: access_node(const key_like& k){
+        //Same walk as find_node, every node on the way is remembered so the found one can be rotated up after
         node* curr = root;
+        counters.looked_up();
+        access_path.clear();
+
         while(curr){
-            if(equals(k, curr->key)){
-                return true;
+            counters.visited();
+            access_path.push_back(curr);
+            int order = compare_keys(k, curr->key); //One comparison picks the branch
+            //Found it, move it up. Nodes are only relinked, so pointers to its value stay good
+            if(order == 0){
+                splay(access_path.size() - 1, mode == access_mode::semi_splay);
+                return curr;
             }
-            else if(compare(k, curr->key)){
+            //Key comes before node we are on, go left
+            else if(order < 0){
                 curr = curr->left;
             }
+            //Go right
             else{
                 curr = curr->right;
             }
         }
 
-        return false;
+        //Miss, nothing to promote
+        return nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: node* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: rotate_up(node* parent, node* child){
+        //Child's inner subtree moves across to parent, then parent hangs below child
+        if(parent->left == child){
+            parent->left = child->right;
+            child->right = parent;
+            counters.rotated_ll();
+        }
+        else{
+            parent->right = child->left;
+            child->left = parent;
+            counters.rotated_rr();
+        }
+
+        //Parent is now below child, so its size is fixed first
+        update_node(parent);
+        update_node(child);
+        return child;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: node** basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: link_to(size_t depth){
+        if(depth == 0){
+            return &root;
+        }
+
+        node* above = access_path[depth - 1];
+        if(above->left == access_path[depth]){
+            return &above->left;
+        }
+        return &above->right;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: splay(size_t depth, bool semi){
+        //Bottom-up splaying along access_path, two levels per step. Each step looks at x, its parent and grandparent
+        //Zig-zig (both on the same side): parent goes above grandparent, then x above parent
+        //Zig-zag: x goes above parent, then above grandparent
+        //Semi-splay does only the first rotation of a zig-zig and carries on from parent, so x ends up about halfway up
+        while(depth >= 2){
+            node* x = access_path[depth];
+            node* parent = access_path[depth - 1];
+            node* grand = access_path[depth - 2];
+            node** link = link_to(depth - 2); //Read before anything moves, it is above all three
+
+            bool zig_zig = (grand->left == parent) == (parent->left == x);
+            if(zig_zig){
+                *link = rotate_up(grand, parent);
+                if(semi){
+                    access_path[depth - 2] = parent;
+                    depth -= 2;
+                    continue;
+                }
+                *link = rotate_up(parent, x);
+            }
+            else{
+                node* up = rotate_up(parent, x);
+                if(grand->left == parent){
+                    grand->left = up;
+                }
+                else{
+                    grand->right = up;
+                }
+                *link = rotate_up(grand, x);
+            }
+
+            access_path[depth - 2] = x;
+            depth -= 2;
+        }
+
+        //Odd depth leaves x (or the node semi-splay carried on from) just below the root, one rotation finishes it
+        if(depth == 1){
+            root = rotate_up(access_path[0], access_path[1]);
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    uint64_t basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: next_random(){
+        //splitmix64, same generator as BSTRAND. A few cycles, far less than the lookup it decides about
+        rng_state += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = rng_state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    bool BSTROOT<key_type, value_type, compare, equals> :: is_empty(){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: prefetch(const void* p){
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p);
+#else
+        (void)p;
+#endif
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename visit>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: find_nodes(const key_type* keys, size_t n, visit found){
+        //Up to batch_lanes descents take turns, each one step at a time, and every step prefetches the child it moves to
+        //By the time a lane comes around again its node has usually arrived, so the lanes wait on their misses together instead of one after another
+        //A lane that finishes takes the next key right away, so a deep search never holds up the rest
+        struct lane{
+            node* curr;
+            size_t index;
+        };
+
+        lane lanes[batch_lanes];
+        size_t active = 0;
+        size_t next = 0;
+
+        //Nothing to walk, every key is missing
+        if(!root){
+            for(size_t i = 0; i < n; i++){
+                counters.looked_up();
+                found(i, nullptr);
+            }
+            return;
+        }
+
+        //Root is shared by every descent and stays in cache, no need to prefetch it
+        while(active < batch_lanes && next < n){
+            counters.looked_up();
+            lanes[active].curr = root;
+            lanes[active].index = next;
+            active++;
+            next++;
+        }
+
+        while(active > 0){
+            size_t i = 0;
+            while(i < active){
+                lane& l = lanes[i];
+                counters.visited();
+                int order = compare_keys(keys[l.index], l.curr->key); //One comparison picks the branch
+
+                //Key matched node this lane is on
+                if(order == 0){
+                    found(l.index, l.curr);
+                }
+                else{
+                    //Step down and start loading the child, it is looked at after every other lane has had its turn
+                    l.curr = order < 0 ? l.curr->left : l.curr->right;
+                    if(l.curr){
+                        prefetch(l.curr);
+                        i++;
+                        continue;
+                    }
+
+                    //Fell off the bottom, key is missing
+                    found(l.index, nullptr);
+                }
+
+                //Lane is done, give it the next key or close it by moving the last lane into its place
+                if(next < n){
+                    counters.looked_up();
+                    l.curr = root;
+                    l.index = next;
+                    next++;
+                    i++;
+                }
+                else{
+                    active--;
+                    l = lanes[active];
+                }
+            }
+        }
+    }
+
+    //PUBLIC FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: insert(const key_type& k, const value_type& v){
+        //Single descent insert, key must not already be in map
+        if(!put(k, false, v)){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: try_insert(const key_type& k, const value_type& v){
+        //Leaves an existing value untouched, returns whether k-v pair was added
+        return put(k, false, v);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: insert_or_assign(const key_type& k, const value_type& v){
+        //Overwrites an existing value, returns whether k-v pair was added
+        return put(k, true, v);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: insert(key_type&& k, value_type&& v){
+        //Same as copying insert, key and value are moved into the new node
+        if(!put(std::move(k), false, std::move(v))){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: try_insert(key_type&& k, value_type&& v){
+        //Nothing is moved from if key is already in map
+        return put(std::move(k), false, std::move(v));
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: insert_or_assign(key_type&& k, value_type&& v){
+        //Value is moved over the old one, or key and value are moved into a new node
+        return put(std::move(k), true, std::move(v));
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename... value_args>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: emplace(const key_type& k, value_args&&... args){
+        //Value is only built once the descent reaches an empty spot, so a duplicate key costs no construction
+        return put(k, false, std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename... value_args>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: emplace(key_type&& k, value_args&&... args){
+        return put(std::move(k), false, std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: remove(const key_type& k){
+        //Check if empty to avoid errors, then call recursive function to remove
+        if(is_empty()){
+            throw std::runtime_error("Cannot remove from an empty map");
+        }
+
+        if(!contains(k)){
+            throw std::runtime_error("Key is not in map");
+        }
+
+        root = do_delete(root, k); //Root itself may be the one removed
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    value_type& basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: lookup(const key_type& k){
+        //Again check if empty and then go through tree looking for key
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        value_type* found = find(k);
+
+        //No key was found, return error
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    value_type* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: find(const key_type& k){
+        //Same walk as lookup, but a miss is reported with nullptr instead of an exception
+        node* found = find_node(k);
+
+        if(!found){
+            return nullptr;
+        }
+
+        return &found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    value_type basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: lookup_or(const key_type& k, const value_type& fallback){
+        //One descent, hands back a copy of fallback if key is missing
+        value_type* found = find(k);
+
+        if(!found){
+            return fallback;
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: contains(const key_type& k){
+        //Same as lookup, just returning bool instead of value
+        return find(k) != nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename key_like, typename key_comparator, typename transparent>
+    value_type& basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: lookup(const key_like& k){
+        //Same as lookup by key, but k is compared as is without building a key_type
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        node* found = find_node(k);
+
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename key_like, typename key_comparator, typename transparent>
+    value_type* basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: find(const key_like& k){
+        node* found = find_node(k);
+
+        if(!found){
+            return nullptr;
+        }
+
+        return &found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename key_like, typename key_comparator, typename transparent>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: contains(const key_like& k){
+        return find_node(k) != nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: lookup_batch(const key_type* keys, size_t n, value_type** out){
+        //Same answers as calling find on every key, misses are nullptr instead of an exception so one bad key doesn't lose the rest
+        find_nodes(keys, n, [out](size_t i, node* found){
+            out[i] = found ? &found->value : nullptr;
+        });
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: contains_batch(const key_type* keys, size_t n, bool* out){
+        find_nodes(keys, n, [out](size_t i, node* found){
+            out[i] = found != nullptr;
+        });
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: is_empty(){
         //BST only empty if root doesnt exist
         if(!root){
             return true;
@@ -359,33 +1046,40 @@ namespace cop3530{
         return false;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    bool BSTROOT<key_type, value_type, compare, equals> :: is_full(){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    bool basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: is_full(){
         //BST never full
         return false;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    size_t BSTROOT<key_type, value_type, compare, equals> :: size(){
-        //Calls on the recursive function for size
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    size_t basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: size(){
+        //Root's cached size covers the whole tree
         return get_size(root);
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    void BSTROOT<key_type, value_type, compare, equals> :: clear(){
-        //Calls recursive deletion, then sets root to nullptr to indicate empty
-        deletion(root);
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: clear(){
+        //Calls recursive deletion unless allocator can free every node at once, then sets root to nullptr to indicate empty
+        if(!allocator<node>::bulk_release){
+            deletion(root);
+        }
+        else{
+            counters.freed(size()); //Nodes go all at once, so they are counted here instead of one by one
+        }
+
+        alloc.release_all();
         root = nullptr;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    int BSTROOT<key_type, value_type, compare, equals> :: height(){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    int basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: height(){
         //Calls recursive function height and subtracts 1 to get rid of counting root as 1
         return get_height(root) - 1;
     }
 
-    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
-    int BSTROOT<key_type, value_type, compare, equals> :: balance(){
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    int basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: balance(){
         //If empty or size == 1, then its 0, otherwise left - right
         if(is_empty() || size() == 1){
             return 0;
@@ -393,6 +1087,217 @@ namespace cop3530{
 
         return get_height(root->left) - get_height(root->right);
     }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: adapt_on_access(access_mode m, size_t one_in){
+        //A rate of 0 would never pick a lookup and divide by zero doing it
+        if(one_in == 0){
+            throw std::runtime_error("Sample rate must be at least 1");
+        }
+
+        mode = m;
+        sample_rate = one_in;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    access_mode basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: adapting(){
+        return mode;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    tree_shape<key_type> basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: shape_report(size_t worst){
+        //Unlike height and balance, this looks at every subtree, and each node only once
+        return measure_shape<key_type>(root, worst);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    tree_stats basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: stats(){
+        return counters.get();
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: reset_stats(){
+        counters.reset();
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    const key_type& basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: select(size_t i){
+        //Uses subtree sizes to pick a side, so only one path is walked
+        if(i >= size()){
+            throw std::runtime_error("Select index is out of range");
+        }
+
+        node* curr = root;
+
+        while(curr){
+            size_t left_size = get_size(curr->left);
+
+            //Exactly i smaller keys, this is the one
+            if(i == left_size){
+                return curr->key;
+            }
+            //Key is somewhere in the left subtree
+            else if(i < left_size){
+                curr = curr->left;
+            }
+            //Skip the left subtree and this node
+            else{
+                i -= left_size + 1;
+                curr = curr->right;
+            }
+        }
+
+        //Subtree sizes are out of sync, should never get here
+        throw std::runtime_error("Select index is out of range");
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    size_t basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: rank(const key_type& k){
+        //Number of keys strictly smaller than k
+        return count_less(k, false);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    size_t basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: count_in_range(const key_type& lo, const key_type& hi){
+        //Keys <= hi minus keys < lo gives keys in [lo, hi]
+        if(compare_keys(hi, lo) < 0){
+            return 0;
+        }
+
+        return count_less(hi, true) - count_less(lo, false);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    template<typename pair_iterator>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: build_from_sorted(pair_iterator first, pair_iterator last){
+        //Pairs need .first as key and .second as value, keys strictly increasing
+        //First pass counts and checks order, so nothing is changed if input is bad
+        size_t n = 0;
+        pair_iterator prev = first;
+
+        for(pair_iterator it = first; it != last; ++it){
+            if(n > 0 && compare_keys(prev->first, it->first) >= 0){
+                throw std::runtime_error("Keys given to build_from_sorted are not strictly increasing");
+            }
+
+            prev = it;
+            n++;
+        }
+
+        //Second pass builds the tree bottom up without any comparisons or rotations
+        clear();
+        root = build_balanced(first, n);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    basic_FROZEN<key_type, value_type, comparator> basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: freeze(){
+        //Iterator already walks the keys in order, which is all FROZEN needs
+        return basic_FROZEN<key_type, value_type, comparator>(begin(), size());
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: save(const std::string& path){
+        //Iterator walks keys in order, which is the order the file needs
+        write_snapshot<key_type, value_type>(path, begin(), size());
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    void basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: load(const std::string& path){
+        //Header and checksum are checked when the file is opened, and build_from_sorted checks the order
+        //before clearing, so a bad file throws with the map untouched
+        basic_SNAPSHOT<key_type, value_type, comparator> file(path);
+        build_from_sorted(file.pairs_begin(), file.pairs_end());
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: iterator basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: begin(){
+        //Smallest key is all the way down the left side
+        iterator it(root);
+        it.push_leftmost(root);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: iterator basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: end(){
+        return iterator(root);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: iterator basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: lower_bound(const key_type& k){
+        //Walks down once, remembering how deep the last node with key >= k was
+        iterator it(root);
+        size_t keep = 0;
+        node* curr = root;
+
+        while(curr){
+            it.path.push_back(curr);
+
+            //Node key >= k is a candidate, a smaller one can only be to the left
+            if(compare_keys(curr->key, k) >= 0){
+                keep = it.path.size();
+                curr = curr->left;
+            }
+            else{
+                curr = curr->right;
+            }
+        }
+
+        //Cut path back to the candidate, no candidate leaves it empty which is end()
+        it.path.resize(keep);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: iterator basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: upper_bound(const key_type& k){
+        //Same walk as lower_bound, but candidate key must be strictly greater
+        iterator it(root);
+        size_t keep = 0;
+        node* curr = root;
+
+        while(curr){
+            it.path.push_back(curr);
+
+            if(compare_keys(k, curr->key) < 0){
+                keep = it.path.size();
+                curr = curr->left;
+            }
+            else{
+                curr = curr->right;
+            }
+        }
+
+        it.path.resize(keep);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: iterator basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: floor(const key_type& k){
+        //Mirror of lower_bound, candidate is a key <= k and a larger one can only be to the right
+        iterator it(root);
+        size_t keep = 0;
+        node* curr = root;
+
+        while(curr){
+            it.path.push_back(curr);
+
+            if(compare_keys(k, curr->key) >= 0){
+                keep = it.path.size();
+                curr = curr->right;
+            }
+            else{
+                curr = curr->left;
+            }
+        }
+
+        it.path.resize(keep);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator, typename stats_policy>
+    typename basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: iterator basic_BSTROOT<key_type, value_type, comparator, allocator, stats_policy> :: ceiling(const key_type& k){
+        //Smallest key >= k is exactly what lower_bound finds
+        return lower_bound(k);
+    }
 }
 
 #endif
@@ -0,0 +1,1120 @@
+#ifndef BTREE_H_INCLUDED
+#define BTREE_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <stdexcept> //For exceptions
+#include <vector> //For iterator paths
+#include <utility> //For std::forward, std::move and std::swap
+#include <type_traits> //For picking the in-node search and checking how a value can be assigned
+#include <limits> //For flipping the sign bit of unsigned keys
+#include <new> //For placement new
+#if defined(__SSE2__)
+#include <immintrin.h> //For SIMD key comparisons
+#endif
+#include "NODEPOOL.h" //For node allocators
+#include "COMPARATOR.h" //For key comparators
+#include "FROZEN.h" //For read-only snapshots
+
+namespace cop3530{
+
+    //In-node search used by BTREE, returns how many of the n sorted keys are less than k, which is where k goes
+    //Generic version is a binary search with the comparator, for any key the SIMD version can't take
+    template<typename key_type, typename comparator, bool packed = std::is_integral<key_type>::value && (sizeof(key_type) == 4 || sizeof(key_type) == 8) && std::is_same<comparator, three_way_compare<key_type>>::value>
+    struct btree_search{
+        static size_t lower(const key_type* keys, size_t n, const key_type& k);
+    };
+
+    //4 and 8 byte integers in their natural order compare a whole block of keys per instruction
+    //Reads run up to the next full block past n, so the key array must be padded to a multiple of 8 slots
+    template<typename key_type, typename comparator>
+    struct btree_search<key_type, comparator, true>{
+        static size_t lower(const key_type* keys, size_t n, const key_type& k);
+        static size_t count_bits(unsigned long long bits); //How many bits are set
+    };
+
+    //B-tree, every node holds up to 31 sorted keys so a lookup touches a handful of nodes instead of one per level of a binary tree
+    //Meant for large maps with small keys, where AVL's two pointers, height and size per key cost more than the key itself
+    //Integer keys with the default comparator are searched inside a node with SSE2/AVX2 compares when the compiler targets them
+    //Keys and values are moved around inside and between nodes, so their move constructors shouldn't throw
+    template<typename key_type, typename value_type, typename comparator = three_way_compare<key_type>, template<typename> class allocator = heap_allocator>
+    class basic_BTREE{
+
+    private:
+
+        static const size_t min_degree = 16; //Every node but the root has between min_degree - 1 and 2 * min_degree - 1 keys
+        static const size_t max_keys = 2 * min_degree - 1;
+        static const size_t slots = max_keys + 1; //One spare slot pads the key array to a whole number of SIMD blocks
+
+        //Leaf node. Keys and values are raw storage, only the first count slots hold live objects
+        struct node{
+            size_t count; //Keys in use
+            bool leaf;
+            alignas(key_type) unsigned char key_bytes[sizeof(key_type) * slots];
+            alignas(value_type) unsigned char value_bytes[sizeof(value_type) * slots];
+
+            //Key bytes start zeroed, so SIMD lanes past count never read uninitialized memory
+            explicit node(bool is_leaf) : count(0), leaf(is_leaf), key_bytes() {}
+
+            key_type* keys(){ return reinterpret_cast<key_type*>(key_bytes); }
+            value_type* values(){ return reinterpret_cast<value_type*>(value_bytes); }
+        };
+
+        //Inner node, a node plus one more child than it has keys. Leaves don't pay for the child array
+        struct branch : node{
+            node* children[slots];
+
+            branch() : node(false) {}
+        };
+
+        static_assert(slots % 8 == 0, "BTREE key arrays must be whole SIMD blocks");
+
+        node* root;
+        size_t total; //Pairs in the tree, nodes don't cache subtree sizes
+        allocator<node> leaf_alloc; //Hands out and takes back every leaf
+        allocator<branch> branch_alloc; //Same for inner nodes
+
+        static const bool bulk_release = allocator<node>::bulk_release && std::is_trivially_destructible<key_type>::value && std::is_trivially_destructible<value_type>::value; //Raw slots hide the pairs from the allocator, so it can only skip the walk if they need no destructor
+
+        template<typename key_like> static int compare_keys(const key_like& a, const key_type& b); //One three-way comparison, negative if a < b, 0 if equal
+        static size_t lower_index(node* x, const key_type& k); //How many keys of x are less than k
+        static branch* as_branch(node* x); //Inner node view of x, x must not be a leaf
+        static void move_entry(node* from, size_t i, node* to, size_t j); //Moves pair i of from into empty slot j of to, slot i is left empty
+        static void destroy_entry(node* x, size_t i); //Destroys pair i of x, slot is left empty
+        void free_node(node* x); //Destroys every pair of x and gives it back to its allocator, children are untouched
+        void deletion(node* x); //Helps the clear function. Frees a subtree recursively, depth is only log base 16 of size
+        node* copy_subtree(node* x); //Used for deep copy, clones a subtree node by node keeping its shape
+        void split_child(branch* x, size_t i); //Splits full child i of x in two, its middle pair moves up into x
+        void merge_children(branch* x, size_t i); //Joins child i, pair i and child i + 1 of x into child i
+        void borrow_from_left(branch* x, size_t i); //Moves a pair from child i - 1 through x into child i
+        void borrow_from_right(branch* x, size_t i); //Moves a pair from child i + 1 through x into child i
+        size_t fill_child(branch* x, size_t i); //Makes sure child i has at least min_degree keys, returns where its keys ended up
+        void do_delete(const key_type& k); //Single top-down pass removing k, which must be in the tree
+        void drop_empty_root(); //Frees a root left with no keys, moving its only child up if it has one
+        template<typename key_arg, typename... value_args> bool put(key_arg&& k, bool assign, value_args&&... args); //Single descent insert shared by the public inserts
+        template<typename value_arg> static void assign_value(value_type& target, value_arg&& v); //Overwrites a value from a single insert argument
+        template<typename... value_args> static void assign_value(value_type& target, value_args&&... args); //Overwrites a value built from several insert arguments
+        node* find_node(const key_type& k, size_t& i); //Returns node holding key and its slot in i, nullptr if missing
+
+    public:
+        //Key-value pair handed out by iterators, key is const so tree order can't be broken
+        struct entry{
+            const key_type& key;
+            value_type& value;
+        };
+
+        //Bidirectional in-order iterator. Keeps the path of (node, slot) from the root since nodes have no parent pointers
+        //A frame below the top means the walk went down child slot of that node, and its pair slot comes next
+        //Any insert or remove invalidates every iterator
+        class iterator{
+
+        private:
+            friend class basic_BTREE;
+
+            //Lets it->key and it->value work even though entries are made on the fly
+            struct arrow{
+                entry e;
+                entry* operator->(){ return &e; }
+            };
+
+            struct frame{
+                node* at;
+                size_t slot;
+            };
+
+            node* root; //Needed so --end() can find the largest key
+            std::vector<frame> path; //Root to current pair, empty means end()
+
+            iterator(node* r) : root(r) {}
+
+            //Pushes curr and then keeps going down the first or last child until a leaf
+            void push_leftmost(node* curr){
+                while(!curr->leaf){
+                    path.push_back(frame{curr, 0});
+                    curr = as_branch(curr)->children[0];
+                }
+                path.push_back(frame{curr, 0});
+            }
+
+            void push_rightmost(node* curr){
+                while(!curr->leaf){
+                    path.push_back(frame{curr, curr->count});
+                    curr = as_branch(curr)->children[curr->count];
+                }
+                path.push_back(frame{curr, curr->count - 1});
+            }
+
+        public:
+            iterator() : root(nullptr) {}
+
+            entry operator*() const{ return entry{path.back().at->keys()[path.back().slot], path.back().at->values()[path.back().slot]}; }
+            arrow operator->() const{ return arrow{**this}; }
+
+            iterator& operator++(){
+                frame& top = path.back();
+
+                //Next key is smallest one in the subtree right of this pair
+                if(!top.at->leaf){
+                    top.slot++;
+                    push_leftmost(as_branch(top.at)->children[top.slot]);
+                    return *this;
+                }
+
+                top.slot++;
+                if(top.slot < top.at->count){
+                    return *this;
+                }
+
+                //Leaf is used up, climb until a node still has a pair after the child we came from
+                path.pop_back();
+                while(!path.empty() && path.back().slot == path.back().at->count){
+                    path.pop_back();
+                }
+                return *this;
+            }
+
+            iterator& operator--(){
+                //Stepping back from end() lands on the largest key
+                if(path.empty()){
+                    push_rightmost(root);
+                    return *this;
+                }
+
+                frame& top = path.back();
+
+                //Previous key is largest one in the subtree left of this pair
+                if(!top.at->leaf){
+                    push_rightmost(as_branch(top.at)->children[top.slot]);
+                    return *this;
+                }
+
+                if(top.slot > 0){
+                    top.slot--;
+                    return *this;
+                }
+
+                //Start of the leaf, climb until a node has a pair before the child we came from
+                path.pop_back();
+                while(!path.empty() && path.back().slot == 0){
+                    path.pop_back();
+                }
+                if(!path.empty()){
+                    path.back().slot--;
+                }
+                return *this;
+            }
+
+            iterator operator++(int){ iterator temp = *this; ++*this; return temp; }
+            iterator operator--(int){ iterator temp = *this; --*this; return temp; }
+
+            bool operator==(const iterator& b) const{
+                //Both at end, or both on the same pair
+                if(path.empty() || b.path.empty()){
+                    return path.empty() && b.path.empty();
+                }
+                return path.back().at == b.path.back().at && path.back().slot == b.path.back().slot;
+            }
+
+            bool operator!=(const iterator& b) const{ return !(*this == b); }
+        };
+
+        basic_BTREE();
+        basic_BTREE(const basic_BTREE& b); //copy constructor
+        basic_BTREE& operator=(const basic_BTREE& b); //Copy assignment operator
+        basic_BTREE(basic_BTREE&& b); //Move constructor
+        basic_BTREE& operator=(basic_BTREE&& b); //Move-assignment operator
+        ~basic_BTREE();
+
+        void insert(const key_type& k, const value_type& v); //Adds k-v pair to map
+        bool try_insert(const key_type& k, const value_type& v); //Adds k-v pair if key is new, returns true if it was added
+        bool insert_or_assign(const key_type& k, const value_type& v); //Adds k-v pair or overwrites existing value, returns true if it was added
+        void insert(key_type&& k, value_type&& v); //Same as above, but key and value are moved into the node
+        bool try_insert(key_type&& k, value_type&& v);
+        bool insert_or_assign(key_type&& k, value_type&& v);
+        template<typename... value_args> bool emplace(const key_type& k, value_args&&... args); //Builds value in place from args if key is new, returns true if it was added
+        template<typename... value_args> bool emplace(key_type&& k, value_args&&... args);
+        void remove(const key_type& k); //Removes k-v pair from map
+        value_type& lookup(const key_type& k); //Returns a reference to the value associated with given key
+        value_type* find(const key_type& k); //Returns a pointer to the value associated with given key, nullptr if missing
+        value_type lookup_or(const key_type& k, const value_type& fallback); //Returns the value associated with given key, fallback if missing
+        bool contains(const key_type& k); //Returns true if tree contains value associated with key
+        bool is_empty(); //Returns true if tree is empty
+        bool is_full(); //Returns true if no more pairs can be added to map
+        size_t size(); //Returns all key value pairs in map
+        void clear(); //Removes all elements from map
+        int height(); //Returns tree's height in nodes below the root, every leaf is at the same depth
+
+        basic_FROZEN<key_type, value_type, comparator> freeze(); //Copies every pair into a read-only map laid out for fast lookups, later changes here don't show up in it
+
+        iterator begin(); //Iterator to smallest key
+        iterator end(); //Iterator past the largest key
+        iterator lower_bound(const key_type& k); //Iterator to first key not less than k
+        iterator upper_bound(const key_type& k); //Iterator to first key greater than k
+    };
+
+    //Original interface, ordering comes from a pair of compare and equals functions
+    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type), template<typename> class allocator = heap_allocator>
+    using BTREE = basic_BTREE<key_type, value_type, function_compare<key_type, compare, equals>, allocator>;
+
+    //IN-NODE SEARCH
+
+    template<typename key_type, typename comparator, bool packed>
+    size_t btree_search<key_type, comparator, packed> :: lower(const key_type* keys, size_t n, const key_type& k){
+        //Binary search, only the comparator knows the order
+        size_t lo = 0;
+        size_t hi = n;
+
+        while(lo < hi){
+            size_t mid = (lo + hi) / 2;
+            if(comparator()(keys[mid], k) < 0){
+                lo = mid + 1;
+            }
+            else{
+                hi = mid;
+            }
+        }
+
+        return lo;
+    }
+
+    template<typename key_type, typename comparator>
+    size_t btree_search<key_type, comparator, true> :: count_bits(unsigned long long bits){
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(bits);
+#else
+        size_t count = 0;
+        while(bits){
+            bits &= bits - 1;
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    template<typename key_type, typename comparator>
+    size_t btree_search<key_type, comparator, true> :: lower(const key_type* keys, size_t n, const key_type& k){
+        //Each block compares every lane against k at once and turns the answers into bits, bit i set if keys[i] < k
+        //Keys are sorted so the set bits are exactly the first ones, counting them gives the slot
+        //Compare instructions are signed, so unsigned keys and k get their top bit flipped to keep the order
+        typedef typename std::make_signed<key_type>::type lane_type;
+        const lane_type bias = std::is_signed<key_type>::value ? 0 : std::numeric_limits<lane_type>::min();
+        const lane_type target = (lane_type)k ^ bias;
+        unsigned long long less = 0;
+        (void)target;
+
+#if defined(__AVX2__)
+        if constexpr(sizeof(key_type) == 4){
+            __m256i wanted = _mm256_set1_epi32(target);
+            __m256i flip = _mm256_set1_epi32(bias);
+            for(size_t i = 0; i < n; i += 8){
+                __m256i block = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), flip);
+                less |= (unsigned long long)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(wanted, block))) << i;
+            }
+        }
+        else{
+            __m256i wanted = _mm256_set1_epi64x(target);
+            __m256i flip = _mm256_set1_epi64x(bias);
+            for(size_t i = 0; i < n; i += 4){
+                __m256i block = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), flip);
+                less |= (unsigned long long)(unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(wanted, block))) << i;
+            }
+        }
+        //Lanes past n hold leftovers, only the first n bits count
+        return count_bits(less & ((1ull << n) - 1));
+#elif defined(__SSE2__)
+        if constexpr(sizeof(key_type) == 4){
+            __m128i wanted = _mm_set1_epi32(target);
+            __m128i flip = _mm_set1_epi32(bias);
+            for(size_t i = 0; i < n; i += 4){
+                __m128i block = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), flip);
+                less |= (unsigned long long)(unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(wanted, block))) << i;
+            }
+            return count_bits(less & ((1ull << n) - 1));
+        }
+#if defined(__SSE4_2__)
+        else{
+            __m128i wanted = _mm_set1_epi64x(target);
+            __m128i flip = _mm_set1_epi64x(bias);
+            for(size_t i = 0; i < n; i += 2){
+                __m128i block = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), flip);
+                less |= (unsigned long long)(unsigned)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(wanted, block))) << i;
+            }
+            return count_bits(less & ((1ull << n) - 1));
+        }
+#endif
+#endif
+
+        //No usable SIMD for this key size, a branch-free count the compiler can still vectorize
+        size_t count = 0;
+        for(size_t i = 0; i < n; i++){
+            count += keys[i] < k;
+        }
+        (void)less;
+        return count;
+    }
+
+    //CONSTRUCTORS AND DESTRUCTORS
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    basic_BTREE<key_type, value_type, comparator, allocator> :: basic_BTREE(){
+        root = nullptr;
+        total = 0;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    basic_BTREE<key_type, value_type, comparator, allocator> :: basic_BTREE(const basic_BTREE& b){ //Deep copy constructor
+        //Clone nodes directly instead of reinserting, so shape carries over
+        root = nullptr;
+        total = 0;
+        if(b.root){
+            root = copy_subtree(b.root);
+        }
+        total = b.total;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    basic_BTREE<key_type, value_type, comparator, allocator>& basic_BTREE<key_type, value_type, comparator, allocator> :: operator=(const basic_BTREE& b){ //Copy assignment operator
+        //Check that this and given tree arent the same
+        if(this == &b){
+            return *this;
+        }
+
+        //Else, clear the tree and add a deep copy of given tree
+        clear();
+        if(b.root){
+            root = copy_subtree(b.root);
+        }
+        total = b.total;
+        return *this;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    basic_BTREE<key_type, value_type, comparator, allocator> :: basic_BTREE(basic_BTREE&& b){ //Move constructor
+        //Creates a shallow copy and leaves given tree empty
+        root = b.root;
+        total = b.total;
+        b.root = nullptr;
+        b.total = 0;
+        leaf_alloc.swap(b.leaf_alloc); //Nodes stay in the pool they came from, so the pools move with them
+        branch_alloc.swap(b.branch_alloc);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    basic_BTREE<key_type, value_type, comparator, allocator>& basic_BTREE<key_type, value_type, comparator, allocator> :: operator=(basic_BTREE&& b){ //Move assignment operator
+        //Check that this and given tree arent the same
+        if(this == &b){
+            return *this;
+        }
+
+        //Free existing tree, copy from given, then leave given tree empty
+        clear();
+        root = b.root;
+        total = b.total;
+        b.root = nullptr;
+        b.total = 0;
+        leaf_alloc.swap(b.leaf_alloc); //Nodes stay in the pool they came from, so the pools move with them
+        branch_alloc.swap(b.branch_alloc);
+        return *this;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    basic_BTREE<key_type, value_type, comparator, allocator> :: ~basic_BTREE(){
+        //To destroy tree, free every node unless the allocators can drop them all at once
+        if(!bulk_release){
+            deletion(root);
+        }
+    }
+
+    //HELPER FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    template<typename key_like>
+    int basic_BTREE<key_type, value_type, comparator, allocator> :: compare_keys(const key_like& a, const key_type& b){
+        //Comparator is stateless, so a temporary is free and the call can be inlined
+        return comparator()(a, b);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    size_t basic_BTREE<key_type, value_type, comparator, allocator> :: lower_index(node* x, const key_type& k){
+        return btree_search<key_type, comparator>::lower(x->keys(), x->count, k);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    typename basic_BTREE<key_type, value_type, comparator, allocator> :: branch* basic_BTREE<key_type, value_type, comparator, allocator> :: as_branch(node* x){
+        return static_cast<branch*>(x);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: move_entry(node* from, size_t i, node* to, size_t j){
+        new (to->keys() + j) key_type(std::move(from->keys()[i]));
+        new (to->values() + j) value_type(std::move(from->values()[i]));
+        destroy_entry(from, i);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: destroy_entry(node* x, size_t i){
+        x->keys()[i].~key_type();
+        x->values()[i].~value_type();
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: free_node(node* x){
+        for(size_t i = 0; i < x->count; i++){
+            destroy_entry(x, i);
+        }
+
+        if(x->leaf){
+            leaf_alloc.deallocate(x);
+        }
+        else{
+            branch_alloc.deallocate(as_branch(x));
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: deletion(node* x){
+        //Children first, then the node itself
+        if(!x){
+            return;
+        }
+
+        if(!x->leaf){
+            for(size_t i = 0; i <= x->count; i++){
+                deletion(as_branch(x)->children[i]);
+            }
+        }
+
+        free_node(x);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    typename basic_BTREE<key_type, value_type, comparator, allocator> :: node* basic_BTREE<key_type, value_type, comparator, allocator> :: copy_subtree(node* x){
+        //count only grows as pairs are copied, so a throw part way frees exactly what was made
+        node* copy;
+        if(x->leaf){
+            copy = leaf_alloc.allocate(true);
+        }
+        else{
+            copy = branch_alloc.allocate();
+        }
+
+        size_t children_made = 0;
+
+        try{
+            for(size_t i = 0; i < x->count; i++){
+                new (copy->keys() + i) key_type(x->keys()[i]);
+                try{
+                    new (copy->values() + i) value_type(x->values()[i]);
+                }
+                catch(...){
+                    copy->keys()[i].~key_type();
+                    throw;
+                }
+                copy->count++;
+            }
+
+            if(!x->leaf){
+                for(; children_made <= x->count; children_made++){
+                    as_branch(copy)->children[children_made] = copy_subtree(as_branch(x)->children[children_made]);
+                }
+            }
+        }
+        catch(...){
+            for(size_t i = 0; i < children_made; i++){
+                deletion(as_branch(copy)->children[i]);
+            }
+            free_node(copy);
+            throw;
+        }
+
+        return copy;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: split_child(branch* x, size_t i){
+        //Child y is full. Its upper min_degree - 1 pairs go to a new node z and its middle pair moves up into x
+        node* y = x->children[i];
+        node* z;
+        if(y->leaf){
+            z = leaf_alloc.allocate(true);
+        }
+        else{
+            z = branch_alloc.allocate();
+        }
+
+        //Nothing below can throw, so the split never stops half way
+        for(size_t j = 0; j < min_degree - 1; j++){
+            move_entry(y, j + min_degree, z, j);
+        }
+        if(!y->leaf){
+            for(size_t j = 0; j < min_degree; j++){
+                as_branch(z)->children[j] = as_branch(y)->children[j + min_degree];
+            }
+        }
+        z->count = min_degree - 1;
+
+        //Make room in x for the middle pair and z
+        for(size_t j = x->count; j > i; j--){
+            move_entry(x, j - 1, x, j);
+            x->children[j + 1] = x->children[j];
+        }
+        move_entry(y, min_degree - 1, x, i);
+        x->children[i + 1] = z;
+        x->count++;
+        y->count = min_degree - 1;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: merge_children(branch* x, size_t i){
+        //Both children have min_degree - 1 keys, so together with pair i they fill one node exactly
+        node* y = x->children[i];
+        node* z = x->children[i + 1];
+
+        move_entry(x, i, y, y->count);
+        for(size_t j = 0; j < z->count; j++){
+            move_entry(z, j, y, y->count + 1 + j);
+        }
+        if(!y->leaf){
+            for(size_t j = 0; j <= z->count; j++){
+                as_branch(y)->children[y->count + 1 + j] = as_branch(z)->children[j];
+            }
+        }
+        y->count += z->count + 1;
+
+        //Close the gap left in x
+        for(size_t j = i + 1; j < x->count; j++){
+            move_entry(x, j, x, j - 1);
+            x->children[j] = x->children[j + 1];
+        }
+        x->count--;
+
+        //z's pairs were all moved out, only its memory is left
+        z->count = 0;
+        free_node(z);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: borrow_from_left(branch* x, size_t i){
+        //Pair i - 1 of x comes down to the front of child i, left sibling's last pair goes up in its place
+        node* c = x->children[i];
+        node* l = x->children[i - 1];
+
+        for(size_t j = c->count; j > 0; j--){
+            move_entry(c, j - 1, c, j);
+        }
+        if(!c->leaf){
+            for(size_t j = c->count + 1; j > 0; j--){
+                as_branch(c)->children[j] = as_branch(c)->children[j - 1];
+            }
+            as_branch(c)->children[0] = as_branch(l)->children[l->count];
+        }
+        move_entry(x, i - 1, c, 0);
+        move_entry(l, l->count - 1, x, i - 1);
+        c->count++;
+        l->count--;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: borrow_from_right(branch* x, size_t i){
+        //Pair i of x comes down to the end of child i, right sibling's first pair goes up in its place
+        node* c = x->children[i];
+        node* r = x->children[i + 1];
+
+        move_entry(x, i, c, c->count);
+        if(!c->leaf){
+            as_branch(c)->children[c->count + 1] = as_branch(r)->children[0];
+        }
+        move_entry(r, 0, x, i);
+
+        for(size_t j = 1; j < r->count; j++){
+            move_entry(r, j, r, j - 1);
+        }
+        if(!r->leaf){
+            for(size_t j = 0; j < r->count; j++){
+                as_branch(r)->children[j] = as_branch(r)->children[j + 1];
+            }
+        }
+        c->count++;
+        r->count--;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    size_t basic_BTREE<key_type, value_type, comparator, allocator> :: fill_child(branch* x, size_t i){
+        //A child with the minimum can't lose a key, so take one from a sibling that can spare it or merge with one
+        if(x->children[i]->count >= min_degree){
+            return i;
+        }
+
+        if(i > 0 && x->children[i - 1]->count >= min_degree){
+            borrow_from_left(x, i);
+            return i;
+        }
+
+        if(i < x->count && x->children[i + 1]->count >= min_degree){
+            borrow_from_right(x, i);
+            return i;
+        }
+
+        //Both siblings are at the minimum too. Merging into the left one moves child i's keys there
+        if(i < x->count){
+            merge_children(x, i);
+            return i;
+        }
+
+        merge_children(x, i - 1);
+        return i - 1;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: do_delete(const key_type& k){
+        //Every node is topped up before the walk enters it, so removing from the leaf at the bottom never underflows
+        //and nothing has to be fixed on the way back up. A key in an inner node is swapped for its predecessor,
+        //which leaves a hole in that node until the walk reaches the predecessor's leaf
+        node* x = root;
+        node* hole = nullptr;
+        size_t hole_slot = 0;
+
+        while(true){
+            if(x->leaf){
+                size_t i;
+
+                //Predecessor is the largest key of the leaf, it fills the hole instead of being destroyed
+                if(hole){
+                    i = x->count - 1;
+                    move_entry(x, i, hole, hole_slot);
+                }
+                else{
+                    i = lower_index(x, k);
+                    destroy_entry(x, i);
+                }
+
+                for(size_t j = i + 1; j < x->count; j++){
+                    move_entry(x, j, x, j - 1);
+                }
+                x->count--;
+                return;
+            }
+
+            branch* b = as_branch(x);
+
+            //Looking for the predecessor, keep to the right edge
+            if(hole){
+                x = b->children[fill_child(b, x->count)];
+                continue;
+            }
+
+            size_t i = lower_index(x, k);
+
+            if(i < x->count && compare_keys(k, x->keys()[i]) == 0){
+                //Left child can spare its largest key, it takes k's place
+                if(b->children[i]->count >= min_degree){
+                    destroy_entry(x, i);
+                    hole = x;
+                    hole_slot = i;
+                    x = b->children[i];
+                }
+                //Right child can spare one, rotating it through x moves k down into the left child
+                else if(b->children[i + 1]->count >= min_degree){
+                    borrow_from_right(b, i);
+                    x = b->children[i];
+                }
+                //Neither can, k goes down with the merged children
+                else{
+                    merge_children(b, i);
+                    x = b->children[i];
+                }
+                continue;
+            }
+
+            x = b->children[fill_child(b, i)];
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: drop_empty_root(){
+        //A merge at the root can leave it with no keys and one child, which becomes the root. Tree gets one level shorter
+        if(!root || root->count > 0){
+            return;
+        }
+
+        node* old = root;
+        if(root->leaf){
+            root = nullptr;
+        }
+        else{
+            root = as_branch(root)->children[0];
+        }
+        free_node(old);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    template<typename key_arg, typename... value_args>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: put(key_arg&& k, bool assign, value_args&&... args){
+        //Full nodes are split on the way down, so the leaf always has room and splits never climb back up
+        if(!root){
+            root = leaf_alloc.allocate(true);
+        }
+
+        //Full root is split under a new root, the only way the tree grows taller
+        if(root->count == max_keys){
+            branch* fresh = branch_alloc.allocate();
+            fresh->children[0] = root;
+            try{
+                split_child(fresh, 0);
+            }
+            catch(...){
+                branch_alloc.deallocate(fresh);
+                throw;
+            }
+            root = fresh;
+        }
+
+        node* x = root;
+
+        while(true){
+            size_t i = lower_index(x, k);
+
+            //Key is already here
+            if(i < x->count && compare_keys(k, x->keys()[i]) == 0){
+                if(assign){
+                    assign_value(x->values()[i], std::forward<value_args>(args)...);
+                }
+                return false;
+            }
+
+            if(x->leaf){
+                //Make room, then build the pair in place. If either constructor throws the leaf is put back
+                for(size_t j = x->count; j > i; j--){
+                    move_entry(x, j - 1, x, j);
+                }
+
+                try{
+                    new (x->keys() + i) key_type(std::forward<key_arg>(k));
+                    try{
+                        new (x->values() + i) value_type(std::forward<value_args>(args)...);
+                    }
+                    catch(...){
+                        x->keys()[i].~key_type();
+                        throw;
+                    }
+                }
+                catch(...){
+                    for(size_t j = i; j < x->count; j++){
+                        move_entry(x, j + 1, x, j);
+                    }
+                    drop_empty_root();
+                    throw;
+                }
+
+                x->count++;
+                total++;
+                return true;
+            }
+
+            branch* b = as_branch(x);
+
+            //Child is full, split it first. Its middle key lands at slot i of x and may be k itself
+            if(b->children[i]->count == max_keys){
+                split_child(b, i);
+
+                int order = compare_keys(k, x->keys()[i]);
+                if(order == 0){
+                    if(assign){
+                        assign_value(x->values()[i], std::forward<value_args>(args)...);
+                    }
+                    return false;
+                }
+                if(order > 0){
+                    i++;
+                }
+            }
+
+            x = b->children[i];
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    template<typename value_arg>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: assign_value(value_type& target, value_arg&& v){
+        //Assign straight over the old value when possible, so a copy can reuse its storage
+        //Otherwise (say an explicit conversion) build a new value and move it in
+        if constexpr(std::is_assignable<value_type&, value_arg&&>::value){
+            target = std::forward<value_arg>(v);
+        }
+        else{
+            target = value_type(std::forward<value_arg>(v));
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    template<typename... value_args>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: assign_value(value_type& target, value_args&&... args){
+        //Several arguments only come from emplace, build the value and move it in
+        target = value_type(std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    typename basic_BTREE<key_type, value_type, comparator, allocator> :: node* basic_BTREE<key_type, value_type, comparator, allocator> :: find_node(const key_type& k, size_t& i){
+        //One in-node search per level, then down the child between the keys around k
+        node* curr = root;
+
+        while(curr){
+            i = lower_index(curr, k);
+
+            if(i < curr->count && compare_keys(k, curr->keys()[i]) == 0){
+                return curr;
+            }
+
+            if(curr->leaf){
+                return nullptr;
+            }
+
+            curr = as_branch(curr)->children[i];
+        }
+
+        return nullptr;
+    }
+
+    //PUBLIC FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: insert(const key_type& k, const value_type& v){
+        //Single descent insert, key must not already be in map
+        if(!put(k, false, v)){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: try_insert(const key_type& k, const value_type& v){
+        //Leaves an existing value untouched, returns whether k-v pair was added
+        return put(k, false, v);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: insert_or_assign(const key_type& k, const value_type& v){
+        //Overwrites an existing value, returns whether k-v pair was added
+        return put(k, true, v);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: insert(key_type&& k, value_type&& v){
+        //Same as copying insert, key and value are moved into the node
+        if(!put(std::move(k), false, std::move(v))){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: try_insert(key_type&& k, value_type&& v){
+        //Nothing is moved from if key is already in map
+        return put(std::move(k), false, std::move(v));
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: insert_or_assign(key_type&& k, value_type&& v){
+        //Value is moved over the old one, or key and value are moved into a new slot
+        return put(std::move(k), true, std::move(v));
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    template<typename... value_args>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: emplace(const key_type& k, value_args&&... args){
+        //Value is only built once the descent reaches its leaf, so a duplicate key costs no construction
+        return put(k, false, std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    template<typename... value_args>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: emplace(key_type&& k, value_args&&... args){
+        return put(std::move(k), false, std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: remove(const key_type& k){
+        //Check first, the removal pass reshapes nodes on its way down and shouldn't do that for a missing key
+        if(is_empty()){
+            throw std::runtime_error("Cannot remove from an empty map");
+        }
+
+        if(!contains(k)){
+            throw std::runtime_error("Key is not in map");
+        }
+
+        do_delete(k);
+        total--;
+        drop_empty_root();
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    value_type& basic_BTREE<key_type, value_type, comparator, allocator> :: lookup(const key_type& k){
+        //Again check if empty and then go through tree looking for key
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        value_type* found = find(k);
+
+        //No key was found, return error
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    value_type* basic_BTREE<key_type, value_type, comparator, allocator> :: find(const key_type& k){
+        //Same walk as lookup, but a miss is reported with nullptr instead of an exception
+        size_t i;
+        node* found = find_node(k, i);
+
+        if(!found){
+            return nullptr;
+        }
+
+        return found->values() + i;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    value_type basic_BTREE<key_type, value_type, comparator, allocator> :: lookup_or(const key_type& k, const value_type& fallback){
+        //One descent, hands back a copy of fallback if key is missing
+        value_type* found = find(k);
+
+        if(!found){
+            return fallback;
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: contains(const key_type& k){
+        //Same as lookup, just returning bool instead of value
+        return find(k) != nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: is_empty(){
+        return total == 0;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    bool basic_BTREE<key_type, value_type, comparator, allocator> :: is_full(){
+        //Tree never full
+        return false;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    size_t basic_BTREE<key_type, value_type, comparator, allocator> :: size(){
+        return total;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    void basic_BTREE<key_type, value_type, comparator, allocator> :: clear(){
+        //Frees every node unless allocators can drop them all at once, then sets root to nullptr to indicate empty
+        if(!bulk_release){
+            deletion(root);
+        }
+
+        leaf_alloc.release_all();
+        branch_alloc.release_all();
+        root = nullptr;
+        total = 0;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    int basic_BTREE<key_type, value_type, comparator, allocator> :: height(){
+        //Every leaf is at the same depth, so the leftmost path is as long as any. Empty tree is -1 like the other trees
+        int h = -1;
+        node* curr = root;
+
+        while(curr){
+            h++;
+            if(curr->leaf){
+                break;
+            }
+            curr = as_branch(curr)->children[0];
+        }
+
+        return h;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    basic_FROZEN<key_type, value_type, comparator> basic_BTREE<key_type, value_type, comparator, allocator> :: freeze(){
+        //Iterator already walks the keys in order, which is all FROZEN needs
+        return basic_FROZEN<key_type, value_type, comparator>(begin(), size());
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    typename basic_BTREE<key_type, value_type, comparator, allocator> :: iterator basic_BTREE<key_type, value_type, comparator, allocator> :: begin(){
+        iterator it(root);
+        if(root){
+            it.push_leftmost(root);
+        }
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    typename basic_BTREE<key_type, value_type, comparator, allocator> :: iterator basic_BTREE<key_type, value_type, comparator, allocator> :: end(){
+        return iterator(root);
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    typename basic_BTREE<key_type, value_type, comparator, allocator> :: iterator basic_BTREE<key_type, value_type, comparator, allocator> :: lower_bound(const key_type& k){
+        //Walk toward k remembering the deepest frame whose pair is >= k, a closer candidate can only be further down
+        iterator it(root);
+        size_t keep = 0;
+        node* curr = root;
+
+        while(curr){
+            size_t i = lower_index(curr, k);
+            it.path.push_back(typename iterator::frame{curr, i});
+
+            if(i < curr->count){
+                keep = it.path.size();
+                if(compare_keys(k, curr->keys()[i]) == 0){
+                    break;
+                }
+            }
+
+            if(curr->leaf){
+                break;
+            }
+            curr = as_branch(curr)->children[i];
+        }
+
+        //Cut path back to the candidate, no candidate leaves it empty which is end()
+        it.path.resize(keep);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator, template<typename> class allocator>
+    typename basic_BTREE<key_type, value_type, comparator, allocator> :: iterator basic_BTREE<key_type, value_type, comparator, allocator> :: upper_bound(const key_type& k){
+        //Same walk, but a pair equal to k is stepped over
+        iterator it(root);
+        size_t keep = 0;
+        node* curr = root;
+
+        while(curr){
+            size_t i = lower_index(curr, k);
+            if(i < curr->count && compare_keys(k, curr->keys()[i]) == 0){
+                i++;
+            }
+            it.path.push_back(typename iterator::frame{curr, i});
+
+            if(i < curr->count){
+                keep = it.path.size();
+            }
+
+            if(curr->leaf){
+                break;
+            }
+            curr = as_branch(curr)->children[i];
+        }
+
+        it.path.resize(keep);
+        return it;
+    }
+}
+
+#endif
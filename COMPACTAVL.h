@@ -0,0 +1,788 @@
+#ifndef COMPACTAVL_H_INCLUDED
+#define COMPACTAVL_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <stdexcept> //For exceptions
+#include <vector> //For node storage and iterator paths
+#include <utility> //For std::forward, std::move and std::swap
+#include <type_traits> //For checking how a value can be assigned
+#include <cstdint> //For 32-bit child links
+#include "COMPARATOR.h" //For key comparators
+#include "FROZEN.h" //For read-only snapshots
+
+namespace cop3530{
+
+    //AVL tree kept in one vector, children are 32-bit indices into it instead of pointers
+    //A node is only key, value and two links. Balance lives in the top bit of each link (set if that side is taller),
+    //so there is no height, no subtree size and no malloc header per node
+    //For 8 byte keys and values a node is 24 bytes, against 48 plus the malloc header for an AVL node
+    //Removing moves the last node into the freed slot, so the vector stays dense and memory follows size
+    //Costs: no select or rank since sizes aren't cached, at most 2^31 - 1 pairs, and any insert or remove
+    //may move nodes, so pointers from find don't survive the next change
+    template<typename key_type, typename value_type, typename comparator = three_way_compare<key_type>>
+    class basic_COMPACTAVL{
+
+    private:
+
+        typedef uint32_t link;
+        static const link none = 0x7fffffff; //Link to no node, one past the largest index
+        static const link taller = 0x80000000; //Flag on a link, the subtree on that side is one level taller
+        static const int max_depth = 64; //An AVL tree of 2^31 nodes is under 45 levels deep
+
+        struct node{
+            key_type key;
+            value_type value;
+            link sides[2]; //Left and right child, each with its taller flag
+
+            //Builds key and value in place from the insert arguments, new node is always a leaf
+            //Nodes are copied and moved by the vector, so this must not be picked for another node
+            template<typename key_arg, typename... value_args, typename = typename std::enable_if<!std::is_same<typename std::decay<key_arg>::type, node>::value>::type>
+            node(key_arg&& k, value_args&&... args) : key(std::forward<key_arg>(k)), value(std::forward<value_args>(args)...), sides{none, none} {}
+        };
+
+        std::vector<node> nodes;
+        link root;
+
+        template<typename key_like> static int compare_keys(const key_like& a, const key_type& b); //One three-way comparison, negative if a < b, 0 if equal
+        link child(link x, int side) const; //Child of x on side 0 (left) or 1 (right), none if missing
+        void set_child(link x, int side, link c); //Relinks a side of x, keeping its taller flag
+        int get_lean(link x) const; //Side of x that is taller, -1 if balanced
+        void set_lean(link x, int side); //Marks a side of x as taller, -1 for balanced
+        link rotate(link x, int side); //Rotates x down toward side, its child from the other side takes its place and is returned
+        void replace_link(const link* path, const int* sides, int depth, link c); //Points the link into path[depth] at c instead
+        void compact(link gone); //Fills the unlinked slot gone with the last node, then drops the last slot
+        template<typename key_arg, typename... value_args> bool put(key_arg&& k, bool assign, value_args&&... args); //Single descent insert shared by the public inserts
+        template<typename value_arg> static void assign_value(value_type& target, value_arg&& v); //Overwrites a value from a single insert argument
+        template<typename... value_args> static void assign_value(value_type& target, value_args&&... args); //Overwrites a value built from several insert arguments
+        link find_node(const key_type& k); //Returns node holding key, none if missing
+
+    public:
+        //Key-value pair handed out by iterators, key is const so tree order can't be broken
+        struct entry{
+            const key_type& key;
+            value_type& value;
+        };
+
+        //Bidirectional in-order iterator. Keeps the path from root to its node as indices
+        //Any insert or remove invalidates every iterator
+        class iterator{
+
+        private:
+            friend class basic_COMPACTAVL;
+
+            //Lets it->key and it->value work even though entries are made on the fly
+            struct arrow{
+                entry e;
+                entry* operator->(){ return &e; }
+            };
+
+            basic_COMPACTAVL* tree;
+            std::vector<link> path; //Root to current node, empty means end()
+
+            iterator(basic_COMPACTAVL* t) : tree(t) {}
+
+            //Pushes curr and then keeps going to one side until the bottom
+            void push_edge(link curr, int side){
+                while(curr != none){
+                    path.push_back(curr);
+                    curr = tree->child(curr, side);
+                }
+            }
+
+        public:
+            iterator() : tree(nullptr) {}
+
+            entry operator*() const{ return entry{tree->nodes[path.back()].key, tree->nodes[path.back()].value}; }
+            arrow operator->() const{ return arrow{**this}; }
+
+            iterator& operator++(){
+                link curr = path.back();
+
+                //Next key is smallest one in right subtree
+                if(tree->child(curr, 1) != none){
+                    push_edge(tree->child(curr, 1), 0);
+                    return *this;
+                }
+
+                //Otherwise climb until we come up from a left child, that parent is next
+                path.pop_back();
+                while(!path.empty() && tree->child(path.back(), 1) == curr){
+                    curr = path.back();
+                    path.pop_back();
+                }
+                return *this;
+            }
+
+            iterator& operator--(){
+                //Stepping back from end() lands on the largest key
+                if(path.empty()){
+                    push_edge(tree->root, 1);
+                    return *this;
+                }
+
+                link curr = path.back();
+
+                //Previous key is largest one in left subtree
+                if(tree->child(curr, 0) != none){
+                    push_edge(tree->child(curr, 0), 1);
+                    return *this;
+                }
+
+                //Otherwise climb until we come up from a right child, that parent is previous
+                path.pop_back();
+                while(!path.empty() && tree->child(path.back(), 0) == curr){
+                    curr = path.back();
+                    path.pop_back();
+                }
+                return *this;
+            }
+
+            iterator operator++(int){ iterator temp = *this; ++*this; return temp; }
+            iterator operator--(int){ iterator temp = *this; --*this; return temp; }
+
+            bool operator==(const iterator& b) const{
+                //Both at end, or both on the same node
+                if(path.empty() || b.path.empty()){
+                    return path.empty() && b.path.empty();
+                }
+                return path.back() == b.path.back();
+            }
+
+            bool operator!=(const iterator& b) const{ return !(*this == b); }
+        };
+
+        basic_COMPACTAVL();
+        basic_COMPACTAVL(const basic_COMPACTAVL& b); //copy constructor
+        basic_COMPACTAVL& operator=(const basic_COMPACTAVL& b); //Copy assignment operator
+        basic_COMPACTAVL(basic_COMPACTAVL&& b); //Move constructor
+        basic_COMPACTAVL& operator=(basic_COMPACTAVL&& b); //Move-assignment operator
+
+        void insert(const key_type& k, const value_type& v); //Adds k-v pair to map
+        bool try_insert(const key_type& k, const value_type& v); //Adds k-v pair if key is new, returns true if it was added
+        bool insert_or_assign(const key_type& k, const value_type& v); //Adds k-v pair or overwrites existing value, returns true if it was added
+        void insert(key_type&& k, value_type&& v); //Same as above, but key and value are moved into the node
+        bool try_insert(key_type&& k, value_type&& v);
+        bool insert_or_assign(key_type&& k, value_type&& v);
+        template<typename... value_args> bool emplace(const key_type& k, value_args&&... args); //Builds value in place from args if key is new, returns true if it was added
+        template<typename... value_args> bool emplace(key_type&& k, value_args&&... args);
+        void remove(const key_type& k); //Removes k-v pair from map
+        value_type& lookup(const key_type& k); //Returns a reference to the value associated with given key
+        value_type* find(const key_type& k); //Returns a pointer to the value associated with given key, nullptr if missing
+        value_type lookup_or(const key_type& k, const value_type& fallback); //Returns the value associated with given key, fallback if missing
+        bool contains(const key_type& k); //Returns true if tree contains value associated with key
+        bool is_empty(); //Returns true if tree is empty
+        bool is_full(); //Returns true if no more pairs can be added to map
+        size_t size(); //Returns all key value pairs in map
+        void clear(); //Removes all elements from map and gives back their memory
+        int height(); //Returns tree's height, found by following the taller side down
+        int balance(); //Returns tree's balance factor
+
+        void reserve(size_t n); //Makes room for n pairs up front, so growing to n never reallocates
+        void shrink_to_fit(); //Gives back room the node vector isn't using
+        size_t memory_usage(); //Bytes held by the map, counting spare room in the node vector
+
+        basic_FROZEN<key_type, value_type, comparator> freeze(); //Copies every pair into a read-only map laid out for fast lookups, later changes here don't show up in it
+
+        iterator begin(); //Iterator to smallest key
+        iterator end(); //Iterator past the largest key
+        iterator lower_bound(const key_type& k); //Iterator to first key not less than k
+        iterator upper_bound(const key_type& k); //Iterator to first key greater than k
+    };
+
+    //Original interface, ordering comes from a pair of compare and equals functions
+    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
+    using COMPACTAVL = basic_COMPACTAVL<key_type, value_type, function_compare<key_type, compare, equals>>;
+
+    //CONSTRUCTORS
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_COMPACTAVL<key_type, value_type, comparator> :: basic_COMPACTAVL(){
+        root = none;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_COMPACTAVL<key_type, value_type, comparator> :: basic_COMPACTAVL(const basic_COMPACTAVL& b) : nodes(b.nodes){ //Deep copy constructor
+        //Indices mean the same thing in a copy of the vector, so copying it copies the tree
+        root = b.root;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_COMPACTAVL<key_type, value_type, comparator>& basic_COMPACTAVL<key_type, value_type, comparator> :: operator=(const basic_COMPACTAVL& b){ //Copy assignment operator
+        //Check that this and given tree arent the same
+        if(this == &b){
+            return *this;
+        }
+
+        nodes = b.nodes;
+        root = b.root;
+        return *this;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_COMPACTAVL<key_type, value_type, comparator> :: basic_COMPACTAVL(basic_COMPACTAVL&& b) : nodes(std::move(b.nodes)){ //Move constructor
+        //Takes the vector and leaves given tree empty
+        root = b.root;
+        b.nodes.clear();
+        b.root = none;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_COMPACTAVL<key_type, value_type, comparator>& basic_COMPACTAVL<key_type, value_type, comparator> :: operator=(basic_COMPACTAVL&& b){ //Move assignment operator
+        //Check that this and given tree arent the same
+        if(this == &b){
+            return *this;
+        }
+
+        nodes = std::move(b.nodes);
+        root = b.root;
+        b.nodes.clear();
+        b.root = none;
+        return *this;
+    }
+
+    //HELPER FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator>
+    template<typename key_like>
+    int basic_COMPACTAVL<key_type, value_type, comparator> :: compare_keys(const key_like& a, const key_type& b){
+        //Comparator is stateless, so a temporary is free and the call can be inlined
+        return comparator()(a, b);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_COMPACTAVL<key_type, value_type, comparator> :: link basic_COMPACTAVL<key_type, value_type, comparator> :: child(link x, int side) const{
+        return nodes[x].sides[side] & none;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: set_child(link x, int side, link c){
+        nodes[x].sides[side] = (nodes[x].sides[side] & taller) | c;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_COMPACTAVL<key_type, value_type, comparator> :: get_lean(link x) const{
+        if(nodes[x].sides[0] & taller){
+            return 0;
+        }
+        if(nodes[x].sides[1] & taller){
+            return 1;
+        }
+        return -1;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: set_lean(link x, int side){
+        //At most one side is ever flagged
+        nodes[x].sides[0] = (nodes[x].sides[0] & none) | (side == 0 ? taller : 0);
+        nodes[x].sides[1] = (nodes[x].sides[1] & none) | (side == 1 ? taller : 0);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_COMPACTAVL<key_type, value_type, comparator> :: link basic_COMPACTAVL<key_type, value_type, comparator> :: rotate(link x, int side){
+        //side 0 is a left rotation, side 1 a right one. Leans are fixed by the caller, who knows the case
+        link c = child(x, 1 - side);
+        set_child(x, 1 - side, child(c, side));
+        set_child(c, side, x);
+        return c;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: replace_link(const link* path, const int* sides, int depth, link c){
+        //Node at depth 0 hangs off root, any other one off its parent one step up the path
+        if(depth == 0){
+            root = c;
+        }
+        else{
+            set_child(path[depth - 1], sides[depth - 1], c);
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: compact(link gone){
+        //Keeps the vector dense. The last node's parent is found by searching for its key, since nodes don't point up
+        link last = (link)(nodes.size() - 1);
+
+        if(gone != last){
+            link parent = none;
+            int side = 0;
+            link curr = root;
+
+            while(curr != last){
+                parent = curr;
+                side = compare_keys(nodes[last].key, nodes[curr].key) > 0;
+                curr = child(curr, side);
+            }
+
+            nodes[gone] = std::move(nodes[last]);
+
+            if(parent == none){
+                root = gone;
+            }
+            else{
+                set_child(parent, side, gone);
+            }
+        }
+
+        nodes.pop_back();
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    template<typename key_arg, typename... value_args>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: put(key_arg&& k, bool assign, value_args&&... args){
+        //Descent records the path, since there are no parent links to climb back up
+        link path[max_depth];
+        int sides[max_depth];
+        int depth = 0;
+        link curr = root;
+
+        while(curr != none){
+            int order = compare_keys(k, nodes[curr].key); //One comparison picks the branch
+
+            //Key is already here
+            if(order == 0){
+                if(assign){
+                    assign_value(nodes[curr].value, std::forward<value_args>(args)...);
+                }
+                return false;
+            }
+
+            path[depth] = curr;
+            sides[depth] = order > 0;
+            depth++;
+            curr = child(curr, order > 0);
+        }
+
+        if(is_full()){
+            throw std::runtime_error("Map is full");
+        }
+
+        //New node goes at the end of the vector, nothing is linked yet if building it throws
+        link fresh = (link)nodes.size();
+        nodes.emplace_back(std::forward<key_arg>(k), std::forward<value_args>(args)...);
+        replace_link(path, sides, depth, fresh);
+
+        //Walk back up while subtrees keep getting taller
+        for(int i = depth - 1; i >= 0; i--){
+            link p = path[i];
+            int side = sides[i];
+            int lean = get_lean(p);
+
+            //Was balanced, now leans toward the new node and is one taller, keep going
+            if(lean == -1){
+                set_lean(p, side);
+                continue;
+            }
+
+            //Was leaning the other way, now balanced and no taller, done
+            if(lean != side){
+                set_lean(p, -1);
+                return true;
+            }
+
+            //Two taller on one side, one rotation brings it back to its old height
+            link c = child(p, side);
+            link top;
+
+            if(get_lean(c) == side){
+                top = rotate(p, 1 - side);
+                set_lean(p, -1);
+                set_lean(c, -1);
+            }
+            else{
+                link g = child(c, 1 - side);
+                int g_lean = get_lean(g);
+                set_child(p, side, rotate(c, side));
+                top = rotate(p, 1 - side);
+                set_lean(p, g_lean == side ? 1 - side : -1);
+                set_lean(c, g_lean == 1 - side ? side : -1);
+                set_lean(g, -1);
+            }
+
+            replace_link(path, sides, i, top);
+            return true;
+        }
+
+        return true;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    template<typename value_arg>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: assign_value(value_type& target, value_arg&& v){
+        //Assign straight over the old value when possible, so a copy can reuse its storage
+        //Otherwise (say an explicit conversion) build a new value and move it in
+        if constexpr(std::is_assignable<value_type&, value_arg&&>::value){
+            target = std::forward<value_arg>(v);
+        }
+        else{
+            target = value_type(std::forward<value_arg>(v));
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    template<typename... value_args>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: assign_value(value_type& target, value_args&&... args){
+        //Several arguments only come from emplace, build the value and move it in
+        target = value_type(std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_COMPACTAVL<key_type, value_type, comparator> :: link basic_COMPACTAVL<key_type, value_type, comparator> :: find_node(const key_type& k){
+        //Plain descent, shared by every lookup
+        link curr = root;
+
+        while(curr != none){
+            int order = compare_keys(k, nodes[curr].key); //One comparison picks the branch
+            if(order == 0){
+                return curr;
+            }
+            curr = child(curr, order > 0);
+        }
+
+        return none;
+    }
+
+    //PUBLIC FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: insert(const key_type& k, const value_type& v){
+        //Single descent insert, key must not already be in map
+        if(!put(k, false, v)){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: try_insert(const key_type& k, const value_type& v){
+        //Leaves an existing value untouched, returns whether k-v pair was added
+        return put(k, false, v);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: insert_or_assign(const key_type& k, const value_type& v){
+        //Overwrites an existing value, returns whether k-v pair was added
+        return put(k, true, v);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: insert(key_type&& k, value_type&& v){
+        //Same as copying insert, key and value are moved into the node
+        if(!put(std::move(k), false, std::move(v))){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: try_insert(key_type&& k, value_type&& v){
+        //Nothing is moved from if key is already in map
+        return put(std::move(k), false, std::move(v));
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: insert_or_assign(key_type&& k, value_type&& v){
+        //Value is moved over the old one, or key and value are moved into a new node
+        return put(std::move(k), true, std::move(v));
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    template<typename... value_args>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: emplace(const key_type& k, value_args&&... args){
+        //Value is only built once the descent reaches an empty spot, so a duplicate key costs no construction
+        return put(k, false, std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    template<typename... value_args>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: emplace(key_type&& k, value_args&&... args){
+        return put(std::move(k), false, std::forward<value_args>(args)...);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: remove(const key_type& k){
+        //Check if empty to avoid errors
+        if(is_empty()){
+            throw std::runtime_error("Cannot remove from an empty map");
+        }
+
+        link path[max_depth];
+        int sides[max_depth];
+        int depth = 0;
+        link curr = root;
+
+        while(curr != none){
+            int order = compare_keys(k, nodes[curr].key);
+            if(order == 0){
+                break;
+            }
+            path[depth] = curr;
+            sides[depth] = order > 0;
+            depth++;
+            curr = child(curr, order > 0);
+        }
+
+        if(curr == none){
+            throw std::runtime_error("Key is not in map");
+        }
+
+        //Two children, trade places with the successor and unlink that node instead, it has no left child
+        if(child(curr, 0) != none && child(curr, 1) != none){
+            link found = curr;
+            path[depth] = curr;
+            sides[depth] = 1;
+            depth++;
+            curr = child(curr, 1);
+
+            while(child(curr, 0) != none){
+                path[depth] = curr;
+                sides[depth] = 0;
+                depth++;
+                curr = child(curr, 0);
+            }
+
+            std::swap(nodes[found].key, nodes[curr].key);
+            std::swap(nodes[found].value, nodes[curr].value);
+        }
+
+        //curr has at most one child, which takes its place
+        link only = child(curr, 0) != none ? child(curr, 0) : child(curr, 1);
+        replace_link(path, sides, depth, only);
+
+        //Walk back up while subtrees keep getting shorter
+        for(int i = depth - 1; i >= 0; i--){
+            link p = path[i];
+            int side = sides[i];
+            int lean = get_lean(p);
+
+            //Was balanced, now leans away and keeps its height, done
+            if(lean == -1){
+                set_lean(p, 1 - side);
+                break;
+            }
+
+            //Was leaning toward the shorter side, now balanced and one shorter, keep going
+            if(lean == side){
+                set_lean(p, -1);
+                continue;
+            }
+
+            //Two taller on the other side, rotate the sibling up
+            link s = child(p, 1 - side);
+            int s_lean = get_lean(s);
+            link top;
+
+            if(s_lean == -1){
+                //Sibling was balanced, height is unchanged after the rotation so we can stop
+                top = rotate(p, side);
+                set_lean(p, 1 - side);
+                set_lean(s, side);
+                replace_link(path, sides, i, top);
+                break;
+            }
+
+            if(s_lean == 1 - side){
+                top = rotate(p, side);
+                set_lean(p, -1);
+                set_lean(s, -1);
+            }
+            else{
+                link g = child(s, side);
+                int g_lean = get_lean(g);
+                set_child(p, 1 - side, rotate(s, 1 - side));
+                top = rotate(p, side);
+                set_lean(p, g_lean == 1 - side ? side : -1);
+                set_lean(s, g_lean == side ? 1 - side : -1);
+                set_lean(g, -1);
+            }
+
+            replace_link(path, sides, i, top);
+        }
+
+        compact(curr);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    value_type& basic_COMPACTAVL<key_type, value_type, comparator> :: lookup(const key_type& k){
+        //Again check if empty and then go through tree looking for key
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        value_type* found = find(k);
+
+        //No key was found, return error
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    value_type* basic_COMPACTAVL<key_type, value_type, comparator> :: find(const key_type& k){
+        //Same walk as lookup, but a miss is reported with nullptr instead of an exception
+        link found = find_node(k);
+
+        if(found == none){
+            return nullptr;
+        }
+
+        return &nodes[found].value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    value_type basic_COMPACTAVL<key_type, value_type, comparator> :: lookup_or(const key_type& k, const value_type& fallback){
+        //One descent, hands back a copy of fallback if key is missing
+        value_type* found = find(k);
+
+        if(!found){
+            return fallback;
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: contains(const key_type& k){
+        //Same as lookup, just returning bool instead of value
+        return find_node(k) != none;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: is_empty(){
+        return root == none;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_COMPACTAVL<key_type, value_type, comparator> :: is_full(){
+        //Every index below none is usable
+        return nodes.size() >= none;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_COMPACTAVL<key_type, value_type, comparator> :: size(){
+        //Vector is dense, one node per pair
+        return nodes.size();
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: clear(){
+        //Swapping with an empty vector frees the storage too, clear alone would keep it
+        std::vector<node>().swap(nodes);
+        root = none;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_COMPACTAVL<key_type, value_type, comparator> :: height(){
+        //Following the taller side at every node walks the longest path. Empty tree is -1 like AVL
+        int h = -1;
+        link curr = root;
+
+        while(curr != none){
+            h++;
+            curr = child(curr, get_lean(curr) == 1);
+        }
+
+        return h;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_COMPACTAVL<key_type, value_type, comparator> :: balance(){
+        //Same sign as AVL, left height minus right height
+        if(root == none){
+            return 0;
+        }
+
+        int lean = get_lean(root);
+        if(lean == 0){
+            return 1;
+        }
+        if(lean == 1){
+            return -1;
+        }
+        return 0;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: reserve(size_t n){
+        nodes.reserve(n);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_COMPACTAVL<key_type, value_type, comparator> :: shrink_to_fit(){
+        nodes.shrink_to_fit();
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_COMPACTAVL<key_type, value_type, comparator> :: memory_usage(){
+        //Vector doubles as it grows, so up to half of this can be spare room until shrink_to_fit
+        //Keys and values that own heap memory (strings, say) aren't followed
+        return sizeof(*this) + nodes.capacity() * sizeof(node);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_FROZEN<key_type, value_type, comparator> basic_COMPACTAVL<key_type, value_type, comparator> :: freeze(){
+        //Iterator already walks the keys in order, which is all FROZEN needs
+        return basic_FROZEN<key_type, value_type, comparator>(begin(), size());
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_COMPACTAVL<key_type, value_type, comparator> :: iterator basic_COMPACTAVL<key_type, value_type, comparator> :: begin(){
+        iterator it(this);
+        it.push_edge(root, 0);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_COMPACTAVL<key_type, value_type, comparator> :: iterator basic_COMPACTAVL<key_type, value_type, comparator> :: end(){
+        return iterator(this);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_COMPACTAVL<key_type, value_type, comparator> :: iterator basic_COMPACTAVL<key_type, value_type, comparator> :: lower_bound(const key_type& k){
+        //Walks down once, remembering how deep the last node with key >= k was
+        iterator it(this);
+        size_t keep = 0;
+        link curr = root;
+
+        while(curr != none){
+            it.path.push_back(curr);
+
+            //Node key >= k is a candidate, a smaller one can only be to the left
+            if(compare_keys(nodes[curr].key, k) >= 0){
+                keep = it.path.size();
+                curr = child(curr, 0);
+            }
+            else{
+                curr = child(curr, 1);
+            }
+        }
+
+        //Cut path back to the candidate, no candidate leaves it empty which is end()
+        it.path.resize(keep);
+        return it;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_COMPACTAVL<key_type, value_type, comparator> :: iterator basic_COMPACTAVL<key_type, value_type, comparator> :: upper_bound(const key_type& k){
+        //Same walk as lower_bound, but candidate key must be strictly greater
+        iterator it(this);
+        size_t keep = 0;
+        link curr = root;
+
+        while(curr != none){
+            it.path.push_back(curr);
+
+            if(compare_keys(k, nodes[curr].key) < 0){
+                keep = it.path.size();
+                curr = child(curr, 0);
+            }
+            else{
+                curr = child(curr, 1);
+            }
+        }
+
+        it.path.resize(keep);
+        return it;
+    }
+}
+
+#endif
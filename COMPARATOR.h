@@ -0,0 +1,90 @@
+#ifndef COMPARATOR_H_INCLUDED
+#define COMPARATOR_H_INCLUDED
+
+#include <string> //For the string specialization
+
+namespace cop3530{
+
+    //Comparators used by the trees. A comparator is a stateless functor taking two keys by const reference
+    //and returning a negative number, 0 or a positive number for less, equal and greater
+    //A comparator that also declares is_transparent lets the trees look up by other types without making a key
+
+    //Default comparator, for any key with == and <
+    //Equality is tested first on purpose: that branch is almost never taken so it predicts well,
+    //and the less/greater choice is left for the compiler to turn into a conditional move
+    template<typename key_type>
+    struct three_way_compare{
+        int operator()(const key_type& a, const key_type& b) const{
+            if(a == b){
+                return 0;
+            }
+            if(a < b){
+                return -1;
+            }
+            return 1;
+        }
+    };
+
+    //Strings already know how to compare three ways, so one pass over the characters is enough
+    //Transparent, so string_view or a C string can be looked up without copying it into a string
+    template<typename char_type, typename traits, typename string_allocator>
+    struct three_way_compare<std::basic_string<char_type, traits, string_allocator>>{
+        using is_transparent = void;
+
+        int operator()(const std::basic_string<char_type, traits, string_allocator>& a, const std::basic_string<char_type, traits, string_allocator>& b) const{
+            return a.compare(b);
+        }
+
+        template<typename key_like>
+        int operator()(const key_like& a, const std::basic_string<char_type, traits, string_allocator>& b) const{
+            //compare only works from the string side, so flip the answer
+            int order = b.compare(a);
+            if(order == 0){
+                return 0;
+            }
+            if(order < 0){
+                return 1;
+            }
+            return -1;
+        }
+
+        template<typename key_like>
+        int operator()(const std::basic_string<char_type, traits, string_allocator>& a, const key_like& b) const{
+            return a.compare(b);
+        }
+    };
+
+    //Transparent version of the default comparator, for any two types that can be compared with == and <
+    //Use it as the comparator argument to look up, say, a long long key with an int
+    struct transparent_compare{
+        using is_transparent = void;
+
+        template<typename left_type, typename right_type>
+        int operator()(const left_type& a, const right_type& b) const{
+            if(a == b){
+                return 0;
+            }
+            if(a < b){
+                return -1;
+            }
+            return 1;
+        }
+    };
+
+    //Adapter for the original compare/equals function pairs, so those instantiations keep working
+    //Functions are template arguments, so the calls are direct and can be inlined
+    template<typename key_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
+    struct function_compare{
+        int operator()(const key_type& a, const key_type& b) const{
+            if(equals(a, b)){
+                return 0;
+            }
+            if(compare(a, b)){
+                return -1;
+            }
+            return 1;
+        }
+    };
+}
+
+#endif
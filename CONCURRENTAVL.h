@@ -0,0 +1,606 @@
+#ifndef CONCURRENTAVL_H_INCLUDED
+#define CONCURRENTAVL_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <stdexcept> //For exceptions
+#include <vector> //For retired node lists
+#include <atomic> //For the published root and reader slots
+#include <mutex> //For serializing writers
+#include <cstdint> //For epochs
+#include "COMPARATOR.h" //For key comparators
+
+namespace cop3530{
+
+    //AVL tree that many threads can use at once
+    //Published nodes are never changed. A writer copies the nodes on its path (and any it rotates),
+    //then swaps in the new root, so readers walk a consistent version without locks, retries or waiting
+    //Writers take one mutex between them. Nodes replaced by a write are freed once no reader that could
+    //still see them is left, which is tracked with epochs: each reader marks the epoch it started in
+    template<typename key_type, typename value_type, typename comparator = three_way_compare<key_type>>
+    class basic_CONCURRENTAVL{
+
+    private:
+
+        struct node{
+            key_type key;
+            value_type value;
+            node* left;
+            node* right;
+            int height; //Cached height of the subtree rooted here, a leaf is 1
+            size_t count; //Number of nodes in the subtree rooted here
+            uint64_t version; //Epoch of the write that made this node, only that write may change it
+
+            node(const key_type& k, const value_type& v, uint64_t ver) : key(k), value(v), left(nullptr), right(nullptr), height(1), count(1), version(ver) {}
+        };
+
+        static const size_t max_readers = 128; //Reader slots, more threads than this just share by probing
+
+        //Each slot on its own cache line so readers on different cores don't fight over it
+        struct alignas(64) reader_slot{
+            std::atomic<uint64_t> epoch; //Epoch the reader started in, 0 if slot is free
+        };
+
+        //Nodes taken out of the tree by one write, freed once every reader is past that write's epoch
+        struct retired_batch{
+            uint64_t epoch;
+            std::vector<node*> nodes;
+        };
+
+        static const size_t reclaim_threshold = 64; //Batches to collect before scanning reader slots
+
+        std::atomic<node*> root;
+        std::atomic<uint64_t> epoch; //Advanced once per write, starts at 1 so 0 can mean a free slot
+        reader_slot slots[max_readers];
+        std::mutex write_lock; //Held for the whole of every write
+        std::vector<retired_batch> limbo; //Retired batches not yet freed, only touched under write_lock
+        std::vector<node*> retired; //Nodes replaced by the write in progress
+        uint64_t write_version; //Epoch of the write in progress
+
+        static int compare_keys(const key_type& a, const key_type& b); //One three-way comparison, negative if a < b, 0 if equal
+        static size_t get_size(const node* curr); //Returns cached size of a subtree, 0 for nullptr
+        static int get_height(const node* curr); //Returns cached height of a subtree, 0 for nullptr
+        static int get_balance(const node* curr); //Returns the balance factor for a subtree
+        static void update_node(node* curr); //Recomputes cached height and size of a node from its children
+        static size_t home_slot(); //Slot this thread tries first
+        static void deletion(node* curr); //Frees a whole subtree, only safe once no reader can see it
+
+        size_t enter_read(); //Marks this thread as reading, returns the slot it took
+        void exit_read(size_t slot); //Clears the slot taken by enter_read
+        const node* find_node(const node* curr, const key_type& k); //Plain descent, caller must be inside a read
+
+        node* own(node* curr); //Returns a node the current write may change, copying and retiring curr if it was published
+        node* rotate_left(node* curr); //Rotates an owned subtree counterclockwise, returns new root
+        node* rotate_right(node* curr); //Rotates an owned subtree clockwise, returns new root
+        node* rebalance(node* curr); //Fixes balance of an owned node whose children just changed
+        node* insert_copy(node* curr, const key_type& k, const value_type& v, bool assign, bool& inserted); //Path copying insert
+        node* delete_copy(node* curr, const key_type& k, bool& removed); //Path copying delete
+        node* remove_min(node* curr, node*& min); //Takes smallest node out of a subtree, hands it back through min
+        void retire_all(node* curr); //Retires a whole subtree, used by clear
+        void begin_write(); //Caller holds write_lock
+        void publish(node* new_root); //Swaps in new root and retires replaced nodes, caller holds write_lock
+        void reclaim(); //Frees batches no reader can still see, caller holds write_lock
+
+    public:
+        basic_CONCURRENTAVL();
+        basic_CONCURRENTAVL(const basic_CONCURRENTAVL& b) = delete; //Shared between threads, so not copyable or movable
+        basic_CONCURRENTAVL& operator=(const basic_CONCURRENTAVL& b) = delete;
+        ~basic_CONCURRENTAVL(); //No other thread may be using the tree
+
+        //Writes, one at a time, never block readers
+        void insert(const key_type& k, const value_type& v); //Adds k-v pair to map
+        bool try_insert(const key_type& k, const value_type& v); //Adds k-v pair if key is new, returns true if it was added
+        bool insert_or_assign(const key_type& k, const value_type& v); //Adds k-v pair or overwrites existing value, returns true if it was added
+        void remove(const key_type& k); //Removes k-v pair from map
+        bool try_remove(const key_type& k); //Removes k-v pair if key is there, returns true if it was removed
+        void clear(); //Removes all elements from map
+
+        //Reads, lock-free. Values come back as copies since a node can be freed once the read is over
+        value_type lookup(const key_type& k); //Returns a copy of the value associated with given key
+        value_type lookup_or(const key_type& k, const value_type& fallback); //Returns the value associated with given key, fallback if missing
+        bool contains(const key_type& k); //Returns true if tree contains value associated with key
+        bool is_empty(); //Returns true if tree is empty
+        size_t size(); //Returns all key value pairs in map
+        int height(); //Returns tree's height
+    };
+
+    //Original interface, ordering comes from a pair of compare and equals functions
+    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
+    using CONCURRENTAVL = basic_CONCURRENTAVL<key_type, value_type, function_compare<key_type, compare, equals>>;
+
+    //CONSTRUCTORS AND DESTRUCTORS
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_CONCURRENTAVL<key_type, value_type, comparator> :: basic_CONCURRENTAVL(){
+        root.store(nullptr);
+        epoch.store(1);
+        write_version = 0;
+        for(size_t i = 0; i < max_readers; i++){
+            slots[i].epoch.store(0);
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_CONCURRENTAVL<key_type, value_type, comparator> :: ~basic_CONCURRENTAVL(){
+        //Nobody else is reading, so the current tree and everything in limbo can go
+        deletion(root.load());
+        for(size_t i = 0; i < limbo.size(); i++){
+            for(size_t j = 0; j < limbo[i].nodes.size(); j++){
+                delete limbo[i].nodes[j];
+            }
+        }
+    }
+
+    //HELPER FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_CONCURRENTAVL<key_type, value_type, comparator> :: compare_keys(const key_type& a, const key_type& b){
+        //Comparator is stateless, so a temporary is free and the call can be inlined
+        return comparator()(a, b);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_CONCURRENTAVL<key_type, value_type, comparator> :: get_size(const node* curr){
+        //Sizes are cached in each node, so this is constant time
+        if(!curr){
+            return 0;
+        }
+
+        return curr->count;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_CONCURRENTAVL<key_type, value_type, comparator> :: get_height(const node* curr){
+        //Heights are cached in each node, so this is constant time
+        if(!curr){
+            return 0;
+        }
+
+        return curr->height;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_CONCURRENTAVL<key_type, value_type, comparator> :: get_balance(const node* curr){
+        //If curr exists, then get balance factor for given node
+        if(curr){
+            return get_height(curr->left) - get_height(curr->right);
+        }
+
+        return 0;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: update_node(node* curr){
+        //Height is taller child plus one, size is both children plus itself
+        int left_height = get_height(curr->left);
+        int right_height = get_height(curr->right);
+        curr->height = (left_height > right_height ? left_height : right_height) + 1;
+        curr->count = get_size(curr->left) + get_size(curr->right) + 1;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_CONCURRENTAVL<key_type, value_type, comparator> :: home_slot(){
+        //Threads get slots in the order they first read, so up to max_readers threads never share one
+        static std::atomic<size_t> next_slot(0);
+        thread_local size_t slot = next_slot.fetch_add(1) % max_readers;
+        return slot;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: deletion(node* curr){
+        //Deletion goes to bottom of tree and works its way up, deleting each node on the way
+        if(curr){
+            deletion(curr->left);
+            deletion(curr->right);
+            delete curr;
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_CONCURRENTAVL<key_type, value_type, comparator> :: enter_read(){
+        //Slot is claimed before root is loaded. A writer that misses the claim has already published,
+        //so this read sees the new root and none of what that writer retired
+        uint64_t e = epoch.load();
+        size_t slot = home_slot();
+
+        while(true){
+            uint64_t expected = 0;
+            if(slots[slot].epoch.compare_exchange_weak(expected, e)){
+                return slot;
+            }
+            slot = (slot + 1) % max_readers; //Taken by a thread sharing this home slot, try the next one
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: exit_read(size_t slot){
+        slots[slot].epoch.store(0, std::memory_order_release);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    const typename basic_CONCURRENTAVL<key_type, value_type, comparator> :: node* basic_CONCURRENTAVL<key_type, value_type, comparator> :: find_node(const node* curr, const key_type& k){
+        while(curr){
+            int order = compare_keys(k, curr->key); //One comparison picks the branch
+            //Key matched node we are on
+            if(order == 0){
+                return curr;
+            }
+            //Key comes before node we are on, go left
+            else if(order < 0){
+                curr = curr->left;
+            }
+            //Go right
+            else{
+                curr = curr->right;
+            }
+        }
+
+        return nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_CONCURRENTAVL<key_type, value_type, comparator> :: node* basic_CONCURRENTAVL<key_type, value_type, comparator> :: own(node* curr){
+        //Nodes made by this write aren't visible to anyone yet, so they can be changed in place
+        if(curr->version == write_version){
+            return curr;
+        }
+
+        //Published node, readers may be on it, so change a copy and retire the original
+        node* copy = new node(*curr);
+        copy->version = write_version;
+        retired.push_back(curr);
+        return copy;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_CONCURRENTAVL<key_type, value_type, comparator> :: node* basic_CONCURRENTAVL<key_type, value_type, comparator> :: rotate_left(node* curr){
+        //Same rotation as AVL, except the child that moves up is owned first
+        node* temp = curr;
+        curr = own(curr->right);
+        temp->right = curr->left;
+        curr->left = temp;
+
+        //Old root is now the child, so its height and size must be fixed first
+        update_node(temp);
+        update_node(curr);
+        return curr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_CONCURRENTAVL<key_type, value_type, comparator> :: node* basic_CONCURRENTAVL<key_type, value_type, comparator> :: rotate_right(node* curr){
+        //Same rotation as AVL, except the child that moves up is owned first
+        node* temp = curr;
+        curr = own(curr->left);
+        temp->left = curr->right;
+        curr->right = temp;
+
+        //Old root is now the child, so its height and size must be fixed first
+        update_node(temp);
+        update_node(curr);
+        return curr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_CONCURRENTAVL<key_type, value_type, comparator> :: node* basic_CONCURRENTAVL<key_type, value_type, comparator> :: rebalance(node* curr){
+        //Child's balance picks single or double rotation, same cases as AVL for both insert and delete
+        update_node(curr);
+        int bf = get_balance(curr);
+
+        //Left heavy, left right case rotates the child first
+        if(bf > 1){
+            if(get_balance(curr->left) < 0){
+                curr->left = rotate_left(own(curr->left));
+            }
+            return rotate_right(curr);
+        }
+
+        //Right heavy, right left case rotates the child first
+        if(bf < -1){
+            if(get_balance(curr->right) > 0){
+                curr->right = rotate_right(own(curr->right));
+            }
+            return rotate_left(curr);
+        }
+
+        return curr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_CONCURRENTAVL<key_type, value_type, comparator> :: node* basic_CONCURRENTAVL<key_type, value_type, comparator> :: insert_copy(node* curr, const key_type& k, const value_type& v, bool assign, bool& inserted){
+        //Empty spot, new node belongs to this write
+        if(!curr){
+            inserted = true;
+            return new node(k, v, write_version);
+        }
+
+        int order = compare_keys(k, curr->key); //One comparison picks the branch
+
+        //Key already in map, a new value means a new copy of this node
+        if(order == 0){
+            if(!assign){
+                return curr;
+            }
+            node* copy = own(curr);
+            copy->value = v;
+            return copy;
+        }
+
+        node* child = order < 0 ? curr->left : curr->right;
+        node* new_child = insert_copy(child, k, v, assign, inserted);
+
+        //Nothing below changed, keep sharing this subtree with the old version
+        if(new_child == child){
+            return curr;
+        }
+
+        node* copy = own(curr);
+        if(order < 0){
+            copy->left = new_child;
+        }
+        else{
+            copy->right = new_child;
+        }
+
+        return rebalance(copy);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_CONCURRENTAVL<key_type, value_type, comparator> :: node* basic_CONCURRENTAVL<key_type, value_type, comparator> :: remove_min(node* curr, node*& min){
+        //Smallest node has no left child, its right subtree takes its place
+        if(!curr->left){
+            min = curr;
+            return curr->right;
+        }
+
+        node* copy = own(curr);
+        copy->left = remove_min(curr->left, min);
+        return rebalance(copy);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_CONCURRENTAVL<key_type, value_type, comparator> :: node* basic_CONCURRENTAVL<key_type, value_type, comparator> :: delete_copy(node* curr, const key_type& k, bool& removed){
+        if(!curr){
+            return curr;
+        }
+
+        int order = compare_keys(k, curr->key); //One comparison picks the branch
+
+        if(order == 0){
+            removed = true;
+            retired.push_back(curr);
+
+            //Zero or one child, child takes its place
+            if(!curr->left){
+                return curr->right;
+            }
+            if(!curr->right){
+                return curr->left;
+            }
+
+            //Two children, successor moves up. It is copied, since readers may still be on the original
+            node* min;
+            node* new_right = remove_min(curr->right, min);
+            node* successor = new node(min->key, min->value, write_version);
+            retired.push_back(min);
+            successor->left = curr->left;
+            successor->right = new_right;
+            return rebalance(successor);
+        }
+
+        node* child = order < 0 ? curr->left : curr->right;
+        node* new_child = delete_copy(child, k, removed);
+
+        //Key wasn't found below, nothing changed
+        if(!removed){
+            return curr;
+        }
+
+        node* copy = own(curr);
+        if(order < 0){
+            copy->left = new_child;
+        }
+        else{
+            copy->right = new_child;
+        }
+
+        return rebalance(copy);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: retire_all(node* curr){
+        if(curr){
+            retire_all(curr->left);
+            retire_all(curr->right);
+            retired.push_back(curr);
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: begin_write(){
+        //Nodes stamped with the current epoch belong to this write
+        write_version = epoch.load();
+        retired.clear();
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: publish(node* new_root){
+        //New root first, then the epoch moves on. Readers that start after this never see retired nodes
+        root.store(new_root);
+
+        if(!retired.empty()){
+            retired_batch batch;
+            batch.epoch = write_version;
+            batch.nodes.swap(retired);
+            limbo.push_back(std::move(batch));
+        }
+        epoch.store(write_version + 1);
+
+        //Scanning every slot costs a cache miss each, so wait until a few batches pile up
+        if(limbo.size() >= reclaim_threshold){
+            reclaim();
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: reclaim(){
+        //Oldest epoch any reader is still in. Batches from before it can't be seen by anyone
+        uint64_t oldest = UINT64_MAX;
+        for(size_t i = 0; i < max_readers; i++){
+            uint64_t e = slots[i].epoch.load();
+            if(e != 0 && e < oldest){
+                oldest = e;
+            }
+        }
+
+        //Batches are in epoch order, free from the front until one might still be in use
+        size_t freed = 0;
+        while(freed < limbo.size() && limbo[freed].epoch < oldest){
+            for(size_t j = 0; j < limbo[freed].nodes.size(); j++){
+                delete limbo[freed].nodes[j];
+            }
+            freed++;
+        }
+        limbo.erase(limbo.begin(), limbo.begin() + freed);
+    }
+
+    //PUBLIC FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: insert(const key_type& k, const value_type& v){
+        //Single descent insert, key must not already be in map
+        if(!try_insert(k, v)){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_CONCURRENTAVL<key_type, value_type, comparator> :: try_insert(const key_type& k, const value_type& v){
+        //Leaves an existing value untouched, returns whether k-v pair was added
+        std::lock_guard<std::mutex> guard(write_lock);
+        begin_write();
+
+        bool inserted = false;
+        node* old_root = root.load();
+        node* new_root = insert_copy(old_root, k, v, false, inserted);
+        if(new_root != old_root){
+            publish(new_root);
+        }
+        return inserted;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_CONCURRENTAVL<key_type, value_type, comparator> :: insert_or_assign(const key_type& k, const value_type& v){
+        //Overwrites an existing value, returns whether k-v pair was added
+        std::lock_guard<std::mutex> guard(write_lock);
+        begin_write();
+
+        bool inserted = false;
+        publish(insert_copy(root.load(), k, v, true, inserted));
+        return inserted;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: remove(const key_type& k){
+        //Check and removal happen under one lock, so no other write can sneak in between
+        std::lock_guard<std::mutex> guard(write_lock);
+
+        if(!root.load()){
+            throw std::runtime_error("Cannot remove from an empty map");
+        }
+
+        begin_write();
+        bool removed = false;
+        node* new_root = delete_copy(root.load(), k, removed);
+        if(!removed){
+            throw std::runtime_error("Key is not in map");
+        }
+        publish(new_root);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_CONCURRENTAVL<key_type, value_type, comparator> :: try_remove(const key_type& k){
+        std::lock_guard<std::mutex> guard(write_lock);
+        begin_write();
+
+        bool removed = false;
+        node* new_root = delete_copy(root.load(), k, removed);
+        if(removed){
+            publish(new_root);
+        }
+        return removed;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_CONCURRENTAVL<key_type, value_type, comparator> :: clear(){
+        //Every node is retired rather than freed, readers may be walking the old tree
+        std::lock_guard<std::mutex> guard(write_lock);
+        begin_write();
+
+        retire_all(root.load());
+        publish(nullptr);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    value_type basic_CONCURRENTAVL<key_type, value_type, comparator> :: lookup(const key_type& k){
+        size_t slot = enter_read();
+        const node* found = find_node(root.load(), k);
+
+        //Copy out while the node is still guaranteed to be there
+        if(!found){
+            exit_read(slot);
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        value_type v = found->value;
+        exit_read(slot);
+        return v;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    value_type basic_CONCURRENTAVL<key_type, value_type, comparator> :: lookup_or(const key_type& k, const value_type& fallback){
+        size_t slot = enter_read();
+        const node* found = find_node(root.load(), k);
+
+        if(!found){
+            exit_read(slot);
+            return fallback;
+        }
+
+        value_type v = found->value;
+        exit_read(slot);
+        return v;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_CONCURRENTAVL<key_type, value_type, comparator> :: contains(const key_type& k){
+        size_t slot = enter_read();
+        bool found = find_node(root.load(), k) != nullptr;
+        exit_read(slot);
+        return found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_CONCURRENTAVL<key_type, value_type, comparator> :: is_empty(){
+        //Only the pointer is read, so no slot is needed
+        return root.load() == nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_CONCURRENTAVL<key_type, value_type, comparator> :: size(){
+        //Root's cached size covers the whole version it belongs to
+        size_t slot = enter_read();
+        size_t n = get_size(root.load());
+        exit_read(slot);
+        return n;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_CONCURRENTAVL<key_type, value_type, comparator> :: height(){
+        //Root's cached height minus 1 to get rid of counting root as 1
+        size_t slot = enter_read();
+        int h = get_height(root.load()) - 1;
+        exit_read(slot);
+        return h;
+    }
+}
+
+#endif
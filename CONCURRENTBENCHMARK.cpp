@@ -0,0 +1,282 @@
+//Multithreaded benchmark for CONCURRENTAVL against AVL behind a lock
+//Runs every tree at several thread counts and read/write mixes, and reports throughput and scaling as JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread CONCURRENTBENCHMARK.cpp -o concurrentbenchmark
+//    ./concurrentbenchmark > concurrent.json
+//
+//Options:
+//    --threads=1,2,4,8,16,32,64  Thread counts to run, default is those
+//    --reads=90,50               Read percentages to run, the rest are writes (half inserts, half removes)
+//    --size=100000               Keys in the tree before each run, drawn from twice as many possible keys
+//    --seconds=0.5               How long each run lasts
+//    --seed=N                    Seed for prefill and every thread's generator, default 12345
+//
+//scaling is ops_per_sec divided by the same tree and mix at 1 thread. Thread counts above the number of
+//cores (hardware_concurrency in the config) only show how the tree holds up when threads get preempted
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtod and friends
+#include <cstring> //For parsing options
+#include <vector> //For threads and results
+#include <random> //For keys and operations
+#include <chrono> //For timing
+#include <thread> //For worker threads
+#include <atomic> //For start and stop flags
+#include <mutex> //For the locked baseline
+#include <shared_mutex> //For the reader-writer baseline
+#include <string> //For option values
+#include "AVL.h"
+#include "CONCURRENTAVL.h"
+
+//TREE ADAPTERS
+
+//Today's setup, one mutex around the whole tree
+struct mutex_avl{
+    cop3530::basic_AVL<int, int> tree;
+    std::mutex lock;
+
+    bool read(int k){
+        std::lock_guard<std::mutex> guard(lock);
+        return tree.find(k) != nullptr;
+    }
+
+    bool write(int k, bool add){
+        std::lock_guard<std::mutex> guard(lock);
+        if(add){
+            return tree.try_insert(k, k);
+        }
+        if(!tree.contains(k)){
+            return false;
+        }
+        tree.remove(k);
+        return true;
+    }
+};
+
+//Readers share the lock, writers still take it alone
+struct shared_mutex_avl{
+    cop3530::basic_AVL<int, int> tree;
+    std::shared_mutex lock;
+
+    bool read(int k){
+        std::shared_lock<std::shared_mutex> guard(lock);
+        return tree.find(k) != nullptr;
+    }
+
+    bool write(int k, bool add){
+        std::unique_lock<std::shared_mutex> guard(lock);
+        if(add){
+            return tree.try_insert(k, k);
+        }
+        if(!tree.contains(k)){
+            return false;
+        }
+        tree.remove(k);
+        return true;
+    }
+};
+
+struct concurrent_avl{
+    cop3530::basic_CONCURRENTAVL<int, int> tree;
+
+    bool read(int k){
+        return tree.contains(k);
+    }
+
+    bool write(int k, bool add){
+        if(add){
+            return tree.try_insert(k, k);
+        }
+        return tree.try_remove(k);
+    }
+};
+
+//RUNNER
+
+struct options{
+    std::vector<size_t> threads;
+    std::vector<int> read_percents;
+    size_t size;
+    double seconds;
+    unsigned long long seed;
+};
+
+struct run_result{
+    unsigned long long ops;
+    unsigned long long reads;
+    unsigned long long writes;
+    double seconds;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+template<typename tree_type>
+static run_result run_once(size_t thread_count, int read_percent, const options& opt){
+    tree_type t;
+    int key_space = (int)(opt.size * 2);
+
+    //Same prefill for every run, so every tree starts from the same keys
+    std::mt19937_64 prefill(opt.seed);
+    std::uniform_int_distribution<int> key_dist(0, key_space - 1);
+    while(t.tree.size() < opt.size){
+        t.write(key_dist(prefill), true);
+    }
+
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned long long> total_reads(0);
+    std::atomic<unsigned long long> total_writes(0);
+    std::vector<std::thread> workers;
+
+    for(size_t i = 0; i < thread_count; i++){
+        workers.emplace_back([&, i]{
+            std::mt19937_64 gen(opt.seed + 1 + i);
+            std::uniform_int_distribution<int> keys(0, key_space - 1);
+            std::uniform_int_distribution<int> roll(0, 99);
+            unsigned long long reads = 0;
+            unsigned long long writes = 0;
+            unsigned long long hits = 0;
+
+            ready.fetch_add(1);
+            while(!go.load()){
+                std::this_thread::yield();
+            }
+
+            //Stop flag is only checked every 64 ops so the relaxed load stays off the profile
+            while(!stop.load(std::memory_order_relaxed)){
+                for(int j = 0; j < 64; j++){
+                    int k = keys(gen);
+                    int r = roll(gen);
+                    if(r < read_percent){
+                        hits += t.read(k);
+                        reads++;
+                    }
+                    else{
+                        hits += t.write(k, r % 2 == 0);
+                        writes++;
+                    }
+                }
+            }
+
+            total_reads.fetch_add(reads);
+            total_writes.fetch_add(writes);
+            if(hits == (unsigned long long)-1){
+                printf(" "); //Keeps hits alive, never happens
+            }
+        });
+    }
+
+    while(ready.load() < thread_count){
+        std::this_thread::yield();
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+    go.store(true);
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.seconds));
+    stop.store(true);
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+    bench_clock::time_point end = bench_clock::now();
+
+    run_result result;
+    result.reads = total_reads.load();
+    result.writes = total_writes.load();
+    result.ops = result.reads + result.writes;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    return result;
+}
+
+template<typename tree_type>
+static void run_tree(const char* name, const options& opt){
+    for(int read_percent : opt.read_percents){
+        double single_thread = 0;
+
+        for(size_t thread_count : opt.threads){
+            run_result r = run_once<tree_type>(thread_count, read_percent, opt);
+            double ops_per_sec = r.seconds > 0 ? r.ops / r.seconds : 0;
+            if(thread_count == 1){
+                single_thread = ops_per_sec;
+            }
+
+            printf("%s\n    {\"tree\": \"%s\", \"threads\": %zu, \"read_percent\": %d, \"ops\": %llu, \"reads\": %llu, \"writes\": %llu, "
+                   "\"seconds\": %.4f, \"ops_per_sec\": %.1f, \"scaling\": %.3f}",
+                   first_result ? "" : ",", name, thread_count, read_percent, r.ops, r.reads, r.writes,
+                   r.seconds, ops_per_sec, single_thread > 0 ? ops_per_sec / single_thread : 0.0);
+            first_result = false;
+            fflush(stdout);
+        }
+    }
+}
+
+template<typename number>
+static std::vector<number> parse_list(const char* p){
+    std::vector<number> values;
+    while(*p){
+        char* end;
+        values.push_back((number)strtoull(p, &end, 10));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.size = 100000;
+    opt.seconds = 0.5;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--threads=", 10) == 0){
+            opt.threads = parse_list<size_t>(arg + 10);
+        }
+        else if(strncmp(arg, "--reads=", 8) == 0){
+            opt.read_percents = parse_list<int>(arg + 8);
+        }
+        else if(strncmp(arg, "--size=", 7) == 0){
+            opt.size = strtoull(arg + 7, nullptr, 10);
+        }
+        else if(strncmp(arg, "--seconds=", 10) == 0){
+            opt.seconds = strtod(arg + 10, nullptr);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.threads.empty()){
+        opt.threads = {1, 2, 4, 8, 16, 32, 64};
+    }
+    if(opt.read_percents.empty()){
+        opt.read_percents = {90, 50};
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    printf("{\n  \"config\": {\"hardware_concurrency\": %u, \"size\": %zu, \"seconds\": %.3f, \"seed\": %llu},\n  \"results\": [",
+           std::thread::hardware_concurrency(), opt.size, opt.seconds, opt.seed);
+
+    run_tree<mutex_avl>("AVL+mutex", opt);
+    run_tree<shared_mutex_avl>("AVL+shared_mutex", opt);
+    run_tree<concurrent_avl>("CONCURRENTAVL", opt);
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
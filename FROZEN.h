@@ -0,0 +1,365 @@
+#ifndef FROZEN_H_INCLUDED
+#define FROZEN_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <stdexcept> //For exceptions
+#include <vector> //For the key and value arrays
+#include <utility> //For std::pair
+#include "COMPARATOR.h" //For key comparators
+
+namespace cop3530{
+
+    //Read-only map in Eytzinger (BFS) order, made by freeze() on any of the trees
+    //Keys sit in one array laid out like a complete binary tree: children of slot k are 2k and 2k + 1 (slots start at 1)
+    //The top levels every search goes through share a few cache lines, and a search looks 4 levels ahead with a
+    //prefetch, so the misses of a lookup overlap instead of coming one after another like in a pointer tree
+    //Search has no data dependent branches, each step is k = 2k + (key at k < target)
+    template<typename key_type, typename value_type, typename comparator = three_way_compare<key_type>>
+    class basic_FROZEN{
+
+    private:
+
+        std::vector<key_type> keys; //keys[k - 1] holds slot k
+        std::vector<value_type> values; //Same order as keys, only read once a search has finished
+
+        static const size_t lookahead = 4; //Levels a prefetch runs ahead of the search, 2^4 slots below k start at slot 16k
+
+        static int compare_keys(const key_type& a, const key_type& b); //One three-way comparison, negative if a < b, 0 if equal
+        static void prefetch(const void* p); //Hint to start loading a cache line, does nothing where the builtin isn't there
+        size_t search(const key_type& k) const; //Slot of the first key not less than k, 0 if there is none
+        size_t upper_search(const key_type& k) const; //Slot of the first key greater than k, 0 if there is none
+        static size_t first_slot(size_t n); //Slot holding the smallest key, 0 if empty
+        static size_t last_slot(size_t n); //Slot holding the largest key, 0 if empty
+        static size_t next_slot(size_t k, size_t n); //Slot of the next key in order, 0 past the largest
+        static size_t prev_slot(size_t k, size_t n); //Slot of the previous key in order, 0 before the smallest
+
+    public:
+        //Key-value pair handed out by iterators, both are const since the map never changes
+        struct entry{
+            const key_type& key;
+            const value_type& value;
+        };
+
+        //Bidirectional in-order iterator. Only a slot number, moving is index math with no stack
+        class iterator{
+
+        private:
+            friend class basic_FROZEN;
+
+            //Lets it->key and it->value work even though entries are made on the fly
+            struct arrow{
+                entry e;
+                const entry* operator->() const{ return &e; }
+            };
+
+            const basic_FROZEN* map;
+            size_t slot; //0 means end()
+
+            iterator(const basic_FROZEN* m, size_t s) : map(m), slot(s) {}
+
+        public:
+            iterator() : map(nullptr), slot(0) {}
+
+            entry operator*() const{ return entry{map->keys[slot - 1], map->values[slot - 1]}; }
+            arrow operator->() const{ return arrow{**this}; }
+
+            iterator& operator++(){ slot = next_slot(slot, map->keys.size()); return *this; }
+
+            iterator& operator--(){
+                //Stepping back from end() lands on the largest key
+                if(slot == 0){
+                    slot = last_slot(map->keys.size());
+                }
+                else{
+                    slot = prev_slot(slot, map->keys.size());
+                }
+                return *this;
+            }
+
+            iterator operator++(int){ iterator temp = *this; ++*this; return temp; }
+            iterator operator--(int){ iterator temp = *this; --*this; return temp; }
+
+            bool operator==(const iterator& b) const{ return slot == b.slot; }
+            bool operator!=(const iterator& b) const{ return slot != b.slot; }
+        };
+
+        basic_FROZEN();
+        template<typename entry_iterator> basic_FROZEN(entry_iterator first, size_t n); //Takes n pairs in increasing key order from anything with it->key and it->value
+
+        const value_type& lookup(const key_type& k) const; //Returns a reference to the value associated with given key
+        const value_type* find(const key_type& k) const; //Returns a pointer to the value associated with given key, nullptr if missing
+        value_type lookup_or(const key_type& k, const value_type& fallback) const; //Returns the value associated with given key, fallback if missing
+        bool contains(const key_type& k) const; //Returns true if map contains value associated with key
+        bool is_empty() const; //Returns true if map is empty
+        size_t size() const; //Returns all key value pairs in map
+
+        iterator begin() const; //Iterator to smallest key
+        iterator end() const; //Iterator past the largest key
+        iterator lower_bound(const key_type& k) const; //Iterator to first key not less than k
+        iterator upper_bound(const key_type& k) const; //Iterator to first key greater than k
+        iterator floor(const key_type& k) const; //Iterator to largest key not greater than k, end() if none
+        iterator ceiling(const key_type& k) const; //Iterator to smallest key not less than k, end() if none
+    };
+
+    //Original interface, ordering comes from a pair of compare and equals functions
+    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
+    using FROZEN = basic_FROZEN<key_type, value_type, function_compare<key_type, compare, equals>>;
+
+    //CONSTRUCTORS
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_FROZEN<key_type, value_type, comparator> :: basic_FROZEN(){
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    template<typename entry_iterator>
+    basic_FROZEN<key_type, value_type, comparator> :: basic_FROZEN(entry_iterator first, size_t n){
+        //Walking the slots in order gives the slot for each rank, so the pairs are read once to find them
+        //and then copied in slot order, which lets the arrays be filled front to back
+        std::vector<std::pair<const key_type*, const value_type*>> sorted;
+        sorted.reserve(n);
+        for(size_t i = 0; i < n; i++, ++first){
+            sorted.push_back(std::make_pair(&first->key, &first->value));
+        }
+
+        std::vector<size_t> rank_of(n + 1);
+        size_t rank = 0;
+        for(size_t k = first_slot(n); k != 0; k = next_slot(k, n)){
+            rank_of[k] = rank;
+            rank++;
+        }
+
+        keys.reserve(n);
+        values.reserve(n);
+        for(size_t k = 1; k <= n; k++){
+            keys.push_back(*sorted[rank_of[k]].first);
+            values.push_back(*sorted[rank_of[k]].second);
+        }
+    }
+
+    //HELPER FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_FROZEN<key_type, value_type, comparator> :: compare_keys(const key_type& a, const key_type& b){
+        //Comparator is stateless, so a temporary is free and the call can be inlined
+        return comparator()(a, b);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_FROZEN<key_type, value_type, comparator> :: prefetch(const void* p){
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p);
+#else
+        (void)p;
+#endif
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_FROZEN<key_type, value_type, comparator> :: search(const key_type& k) const{
+        //Goes right while the slot's key is less than k, left otherwise, all the way down
+        //Past the bottom, the low bits of k record the turns. Cutting off the trailing right turns and the
+        //last left turn leaves the last slot where we went left, which is the first key not less than k
+        size_t n = keys.size();
+        const key_type* base = keys.data();
+        size_t slot = 1;
+
+        while(slot <= n){
+            //Prefetching past the end of the array is harmless, it is only a hint
+            prefetch(base + (slot << lookahead) - 1);
+            slot = 2 * slot + (compare_keys(base[slot - 1], k) < 0);
+        }
+
+#if defined(__GNUC__) || defined(__clang__)
+        slot >>= __builtin_ctzll(~(unsigned long long)slot) + 1;
+#else
+        while(slot & 1){
+            slot >>= 1;
+        }
+        slot >>= 1;
+#endif
+        return slot;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_FROZEN<key_type, value_type, comparator> :: upper_search(const key_type& k) const{
+        //Same as search, but equal keys go right too
+        size_t n = keys.size();
+        const key_type* base = keys.data();
+        size_t slot = 1;
+
+        while(slot <= n){
+            prefetch(base + (slot << lookahead) - 1);
+            slot = 2 * slot + (compare_keys(base[slot - 1], k) <= 0);
+        }
+
+#if defined(__GNUC__) || defined(__clang__)
+        slot >>= __builtin_ctzll(~(unsigned long long)slot) + 1;
+#else
+        while(slot & 1){
+            slot >>= 1;
+        }
+        slot >>= 1;
+#endif
+        return slot;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_FROZEN<key_type, value_type, comparator> :: first_slot(size_t n){
+        //Smallest key is all the way down the left side
+        if(n == 0){
+            return 0;
+        }
+
+        size_t slot = 1;
+        while(2 * slot <= n){
+            slot = 2 * slot;
+        }
+        return slot;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_FROZEN<key_type, value_type, comparator> :: last_slot(size_t n){
+        //Largest key is all the way down the right side
+        if(n == 0){
+            return 0;
+        }
+
+        size_t slot = 1;
+        while(2 * slot + 1 <= n){
+            slot = 2 * slot + 1;
+        }
+        return slot;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_FROZEN<key_type, value_type, comparator> :: next_slot(size_t k, size_t n){
+        //Next key is smallest one in right subtree
+        if(2 * k + 1 <= n){
+            k = 2 * k + 1;
+            while(2 * k <= n){
+                k = 2 * k;
+            }
+            return k;
+        }
+
+        //Otherwise climb until we come up from a left child (even slot), that parent is next. Root climbs to 0
+        while(k & 1){
+            k >>= 1;
+        }
+        return k >> 1;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_FROZEN<key_type, value_type, comparator> :: prev_slot(size_t k, size_t n){
+        //Previous key is largest one in left subtree
+        if(2 * k <= n){
+            k = 2 * k;
+            while(2 * k + 1 <= n){
+                k = 2 * k + 1;
+            }
+            return k;
+        }
+
+        //Otherwise climb until we come up from a right child (odd slot other than the root), that parent is previous
+        while(k > 1 && !(k & 1)){
+            k >>= 1;
+        }
+        return k >> 1;
+    }
+
+    //PUBLIC FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator>
+    const value_type& basic_FROZEN<key_type, value_type, comparator> :: lookup(const key_type& k) const{
+        //Same errors as the trees
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        const value_type* found = find(k);
+
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    const value_type* basic_FROZEN<key_type, value_type, comparator> :: find(const key_type& k) const{
+        //First key not less than k is the only one that can match, one more comparison tells if it does
+        size_t slot = search(k);
+
+        if(slot == 0 || compare_keys(k, keys[slot - 1]) != 0){
+            return nullptr;
+        }
+
+        return &values[slot - 1];
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    value_type basic_FROZEN<key_type, value_type, comparator> :: lookup_or(const key_type& k, const value_type& fallback) const{
+        const value_type* found = find(k);
+
+        if(!found){
+            return fallback;
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_FROZEN<key_type, value_type, comparator> :: contains(const key_type& k) const{
+        return find(k) != nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_FROZEN<key_type, value_type, comparator> :: is_empty() const{
+        return keys.empty();
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_FROZEN<key_type, value_type, comparator> :: size() const{
+        return keys.size();
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_FROZEN<key_type, value_type, comparator> :: iterator basic_FROZEN<key_type, value_type, comparator> :: begin() const{
+        return iterator(this, first_slot(keys.size()));
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_FROZEN<key_type, value_type, comparator> :: iterator basic_FROZEN<key_type, value_type, comparator> :: end() const{
+        return iterator(this, 0);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_FROZEN<key_type, value_type, comparator> :: iterator basic_FROZEN<key_type, value_type, comparator> :: lower_bound(const key_type& k) const{
+        return iterator(this, search(k));
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_FROZEN<key_type, value_type, comparator> :: iterator basic_FROZEN<key_type, value_type, comparator> :: upper_bound(const key_type& k) const{
+        return iterator(this, upper_search(k));
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_FROZEN<key_type, value_type, comparator> :: iterator basic_FROZEN<key_type, value_type, comparator> :: floor(const key_type& k) const{
+        //Key before the first greater one. If every key is greater there is no floor
+        size_t slot = upper_search(k);
+
+        if(slot == 0){
+            return iterator(this, last_slot(keys.size()));
+        }
+
+        return iterator(this, prev_slot(slot, keys.size()));
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_FROZEN<key_type, value_type, comparator> :: iterator basic_FROZEN<key_type, value_type, comparator> :: ceiling(const key_type& k) const{
+        //Same thing as lower_bound, named to match floor
+        return lower_bound(k);
+    }
+}
+
+#endif
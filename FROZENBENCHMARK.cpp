@@ -0,0 +1,225 @@
+//Read benchmark for FROZEN against pointer-based lookups in AVL
+//Builds every structure from the same random keys, then times random lookups and lower_bounds and reports them as JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread FROZENBENCHMARK.cpp -o frozenbenchmark
+//    ./frozenbenchmark > frozen.json
+//
+//Options:
+//    --sizes=1000000,10000000    Keys in each structure, default is those
+//    --queries=N                 Lookups and lower_bounds timed per structure and size, default 5000000
+//    --seed=N                    Seed for keys and queries, default 12345
+//
+//An AVL<int, int> node takes about 40 bytes, so 100000000 keys needs 4GB for the tree alone plus the frozen
+//copy. Only ask for that size on a machine with enough memory. Lookups draw from keys that are in the map,
+//lower_bounds draw from the whole key range so about half of them miss. sorted_array is std::lower_bound on
+//a plain sorted vector, which is what FROZEN has to beat to be worth the unusual layout
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtoull and friends
+#include <cstring> //For parsing options
+#include <vector> //For keys and queries
+#include <random> //For keys and queries
+#include <chrono> //For timing
+#include <algorithm> //For sort, unique and lower_bound
+#include <string> //For option values
+#include "AVL.h"
+#include "FROZEN.h"
+
+//STRUCTURE ADAPTERS
+
+//Every adapter answers find and lower_bound with a number so the work can't be optimized away
+template<template<typename> class allocator>
+struct avl_reads{
+    cop3530::basic_AVL<int, int, cop3530::three_way_compare<int>, allocator> tree;
+
+    explicit avl_reads(const std::vector<int>& sorted){
+        std::vector<std::pair<int, int>> pairs;
+        pairs.reserve(sorted.size());
+        for(int k : sorted){
+            pairs.push_back(std::make_pair(k, k));
+        }
+        tree.build_from_sorted(pairs.begin(), pairs.end());
+    }
+
+    long long find(int k){
+        int* v = tree.find(k);
+        return v ? *v : -1;
+    }
+
+    long long lower_bound(int k){
+        auto it = tree.lower_bound(k);
+        return it == tree.end() ? -1 : it->key;
+    }
+};
+
+struct sorted_array_reads{
+    std::vector<int> keys;
+    std::vector<int> values;
+
+    explicit sorted_array_reads(const std::vector<int>& sorted) : keys(sorted), values(sorted) {}
+
+    long long find(int k){
+        auto it = std::lower_bound(keys.begin(), keys.end(), k);
+        return it != keys.end() && *it == k ? values[it - keys.begin()] : -1;
+    }
+
+    long long lower_bound(int k){
+        auto it = std::lower_bound(keys.begin(), keys.end(), k);
+        return it == keys.end() ? -1 : *it;
+    }
+};
+
+//Frozen from an AVL the way a caller would do it, the tree is dropped once the copy is made
+struct frozen_reads{
+    cop3530::basic_FROZEN<int, int> map;
+
+    explicit frozen_reads(const std::vector<int>& sorted){
+        avl_reads<cop3530::heap_allocator> source(sorted);
+        map = source.tree.freeze();
+    }
+
+    long long find(int k){
+        const int* v = map.find(k);
+        return v ? *v : -1;
+    }
+
+    long long lower_bound(int k){
+        auto it = map.lower_bound(k);
+        return it == map.end() ? -1 : it->key;
+    }
+};
+
+//RUNNER
+
+struct options{
+    std::vector<size_t> sizes;
+    size_t queries;
+    unsigned long long seed;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+static void report(const char* name, const char* op, size_t size, size_t queries, double seconds, double build_seconds, long long checksum){
+    printf("%s\n    {\"structure\": \"%s\", \"op\": \"%s\", \"size\": %zu, \"queries\": %zu, \"seconds\": %.4f, "
+           "\"ns_per_op\": %.2f, \"build_seconds\": %.4f, \"checksum\": %lld}",
+           first_result ? "" : ",", name, op, size, queries, seconds, seconds * 1e9 / queries, build_seconds, checksum);
+    first_result = false;
+    fflush(stdout);
+}
+
+template<typename reads_type>
+static void run_structure(const char* name, const std::vector<int>& sorted, const std::vector<int>& hits, const std::vector<int>& probes){
+    bench_clock::time_point start = bench_clock::now();
+    reads_type r(sorted);
+    double build_seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+    //Checksums have to agree across structures, which doubles as a check that they answer the same
+    long long checksum = 0;
+    start = bench_clock::now();
+    for(int k : hits){
+        checksum += r.find(k);
+    }
+    report(name, "lookup", sorted.size(), hits.size(), std::chrono::duration<double>(bench_clock::now() - start).count(), build_seconds, checksum);
+
+    checksum = 0;
+    start = bench_clock::now();
+    for(int k : probes){
+        checksum += r.lower_bound(k);
+    }
+    report(name, "lower_bound", sorted.size(), probes.size(), std::chrono::duration<double>(bench_clock::now() - start).count(), build_seconds, checksum);
+}
+
+static void run_size(size_t size, const options& opt){
+    //Distinct keys spread over twice their count, so about half of the probes miss
+    std::mt19937_64 gen(opt.seed + size);
+    std::uniform_int_distribution<int> key_dist(0, (int)(size * 2));
+    std::vector<int> sorted;
+    sorted.reserve(size + size / 4);
+    while(sorted.size() < size){
+        while(sorted.size() < size + size / 8){
+            sorted.push_back(key_dist(gen));
+        }
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    }
+
+    //Dropping random keys keeps the rest spread evenly
+    std::shuffle(sorted.begin(), sorted.end(), gen);
+    sorted.resize(size);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<int> hits(opt.queries);
+    std::vector<int> probes(opt.queries);
+    std::uniform_int_distribution<size_t> index_dist(0, size - 1);
+    for(size_t i = 0; i < opt.queries; i++){
+        hits[i] = sorted[index_dist(gen)];
+        probes[i] = key_dist(gen);
+    }
+
+    run_structure<avl_reads<cop3530::heap_allocator>>("AVL", sorted, hits, probes);
+    run_structure<avl_reads<cop3530::pool_allocator>>("AVL+pool", sorted, hits, probes);
+    run_structure<sorted_array_reads>("sorted_array", sorted, hits, probes);
+    run_structure<frozen_reads>("FROZEN", sorted, hits, probes);
+}
+
+template<typename number>
+static std::vector<number> parse_list(const char* p){
+    std::vector<number> values;
+    while(*p){
+        char* end;
+        values.push_back((number)strtoull(p, &end, 10));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.queries = 5000000;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--sizes=", 8) == 0){
+            opt.sizes = parse_list<size_t>(arg + 8);
+        }
+        else if(strncmp(arg, "--queries=", 10) == 0){
+            opt.queries = strtoull(arg + 10, nullptr, 10);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.sizes.empty()){
+        opt.sizes = {1000000, 10000000};
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    printf("{\n  \"config\": {\"queries\": %zu, \"seed\": %llu},\n  \"results\": [", opt.queries, opt.seed);
+
+    for(size_t size : opt.sizes){
+        if(size > 0){
+            run_size(size, opt);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,202 @@
+//Memory per entry for every map with 8 byte keys and 8 byte values
+//Builds each structure from the same random keys, then reports how much heap it holds as JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread MEMORYBENCHMARK.cpp -o memorybenchmark
+//    ./memorybenchmark > memory.json
+//
+//Options:
+//    --sizes=1000000             Pairs in each structure, default is that
+//    --seed=N                    Seed for the keys, default 12345
+//
+//heap_bytes is what malloc itself has handed out (glibc's mallinfo2, so per-block headers and padding are counted,
+//unlike the operator new tracking in BENCHMARK.cpp), minus what was in use before the structure was built.
+//Needs glibc. COMPACTAVL is also reported after shrink_to_fit, since its vector can be up to half spare room
+//after growing, and its own memory_usage() is printed next to what malloc saw
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtoull
+#include <cstring> //For parsing options
+#include <cstdint> //For 8 byte keys
+#include <vector> //For keys
+#include <random> //For keys
+#include <chrono> //For timing
+#include <algorithm> //For shuffling
+#include <map> //Baseline
+#include <malloc.h> //For mallinfo2
+#include "AVL.h"
+#include "BSTLEAF.h"
+#include "BSTROOT.h"
+#include "BSTRAND.h"
+#include "BTREE.h"
+#include "COMPACTAVL.h"
+
+typedef uint64_t key_type;
+typedef uint64_t value_type;
+
+//MEMORY
+
+static long long heap_in_use(){
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    //Small blocks come from the arena, big ones (vectors, say) are mapped on their own
+    struct mallinfo2 info = mallinfo2();
+    return (long long)(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+//TREE ADAPTERS
+
+template<typename tree_type>
+struct tree_ops{
+    static void insert(tree_type& t, key_type k){ t.insert(k, k); }
+    static long long reported(tree_type&){ return -1; } //Trees that don't count their own memory
+};
+
+template<>
+struct tree_ops<std::map<key_type, value_type>>{
+    static void insert(std::map<key_type, value_type>& t, key_type k){ t.emplace(k, k); }
+    static long long reported(std::map<key_type, value_type>&){ return -1; }
+};
+
+template<>
+struct tree_ops<cop3530::basic_COMPACTAVL<key_type, value_type>>{
+    static void insert(cop3530::basic_COMPACTAVL<key_type, value_type>& t, key_type k){ t.insert(k, k); }
+    static long long reported(cop3530::basic_COMPACTAVL<key_type, value_type>& t){ return (long long)t.memory_usage(); }
+};
+
+//RUNNER
+
+struct options{
+    std::vector<size_t> sizes;
+    unsigned long long seed;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+static void report(const char* name, const char* alloc, size_t size, long long bytes, long long reported, double build_seconds){
+    printf("%s\n    {\"structure\": \"%s\", \"allocator\": \"%s\", \"size\": %zu, \"heap_bytes\": %lld, \"bytes_per_entry\": %.2f, "
+           "\"reported_bytes\": %lld, \"build_seconds\": %.4f}",
+           first_result ? "" : ",", name, alloc, size, bytes, size ? (double)bytes / size : 0.0, reported, build_seconds);
+    first_result = false;
+    fflush(stdout);
+}
+
+template<typename tree_type>
+static void run_structure(const char* name, const char* alloc, const std::vector<key_type>& keys){
+    long long before = heap_in_use();
+    bench_clock::time_point start = bench_clock::now();
+
+    //Heap allocated so the tree object itself is counted too
+    tree_type* t = new tree_type;
+    for(key_type k : keys){
+        tree_ops<tree_type>::insert(*t, k);
+    }
+
+    double build_seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    report(name, alloc, keys.size(), heap_in_use() - before, tree_ops<tree_type>::reported(*t), build_seconds);
+    delete t;
+}
+
+static void run_shrunk_compact(const std::vector<key_type>& keys){
+    //Same as above, but the vector gives back its spare room before measuring
+    long long before = heap_in_use();
+    bench_clock::time_point start = bench_clock::now();
+
+    cop3530::basic_COMPACTAVL<key_type, value_type>* t = new cop3530::basic_COMPACTAVL<key_type, value_type>;
+    for(key_type k : keys){
+        t->insert(k, k);
+    }
+    t->shrink_to_fit();
+
+    double build_seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    report("COMPACTAVL+shrink_to_fit", "vector", keys.size(), heap_in_use() - before, (long long)t->memory_usage(), build_seconds);
+    delete t;
+}
+
+static void run_size(size_t size, const options& opt){
+    using namespace cop3530;
+    typedef three_way_compare<key_type> key_compare;
+
+    //Distinct random keys in random order
+    std::mt19937_64 gen(opt.seed + size);
+    std::vector<key_type> keys(size);
+    for(size_t i = 0; i < size; i++){
+        keys[i] = (gen() & 0xffffffff00000000ull) | i; //Low bits make every key distinct
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    run_structure<std::map<key_type, value_type>>("std::map", "std", keys);
+    run_structure<basic_AVL<key_type, value_type>>("AVL", "heap", keys);
+    run_structure<basic_AVL<key_type, value_type, key_compare, pool_allocator>>("AVL", "pool", keys);
+    run_structure<basic_BSTLEAF<key_type, value_type>>("BSTLEAF", "heap", keys);
+    run_structure<basic_BSTROOT<key_type, value_type>>("BSTROOT", "heap", keys);
+    run_structure<basic_BSTRAND<key_type, value_type>>("BSTRAND", "heap", keys);
+    run_structure<basic_BTREE<key_type, value_type>>("BTREE", "heap", keys);
+    run_structure<basic_BTREE<key_type, value_type, key_compare, pool_allocator>>("BTREE", "pool", keys);
+    run_structure<basic_COMPACTAVL<key_type, value_type>>("COMPACTAVL", "vector", keys);
+    run_shrunk_compact(keys);
+}
+
+template<typename number>
+static std::vector<number> parse_list(const char* p){
+    std::vector<number> values;
+    while(*p){
+        char* end;
+        values.push_back((number)strtoull(p, &end, 10));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--sizes=", 8) == 0){
+            opt.sizes = parse_list<size_t>(arg + 8);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.sizes.empty()){
+        opt.sizes = {1000000};
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    if(heap_in_use() < 0){
+        fprintf(stderr, "Heap sizes come from mallinfo2, which needs glibc 2.33 or newer\n");
+        return 1;
+    }
+
+    printf("{\n  \"config\": {\"key_bytes\": %zu, \"value_bytes\": %zu, \"seed\": %llu},\n  \"results\": [", sizeof(key_type), sizeof(value_type), opt.seed);
+
+    for(size_t size : opt.sizes){
+        if(size > 0){
+            run_size(size, opt);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
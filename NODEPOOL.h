@@ -0,0 +1,408 @@
+#ifndef NODEPOOL_H_INCLUDED
+#define NODEPOOL_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <new> //For placement new
+#include <type_traits> //For checking if nodes need their destructor run
+#include <utility> //For std::forward
+#include <vector> //For the slabs an arena keeps
+#include <memory> //For sharing arenas between pools
+#include <mutex> //For pools on different threads sharing an arena
+
+namespace cop3530{
+
+    //Node allocators used by the trees. A tree asks for allocator<node> and only calls
+    //allocate, deallocate, release_all, swap, splice, share and shared, so any class with those can be plugged in
+    //allocate forwards its arguments to the node constructor, so keys and values are built in place
+
+    //Default allocator, every node comes from new and goes back with delete
+    template<typename node_type>
+    class heap_allocator{
+
+    public:
+        static const bool bulk_release = false; //Nodes are separate blocks, tree has to free each one
+
+        template<typename... args> node_type* allocate(args&&... a); //Returns a node constructed from a
+        void deallocate(node_type* n); //Destroys and frees a single node
+        void release_all(); //Nothing is owned by the allocator itself, so nothing to do
+        void swap(heap_allocator& b); //No state to exchange
+        void splice(heap_allocator& b); //Nothing to take over
+        void share(heap_allocator& b); //Nothing to hold on to
+        bool shared(); //Never, nodes don't belong to any one heap allocator
+    };
+
+    //Slab allocator, carves nodes out of big blocks and recycles freed ones through a free list
+    //If nodes are trivially destructible and the pool isn't shared, the tree can drop every node at once with release_all
+    //Pools whose nodes can end up in each other's trees, like the halves of a split tree, share an arena.
+    //Each pool still carves slots only from slabs it added itself. The arena keeps those slabs alive and takes
+    //back the free slots of a pool that lets go, so the pools left using it hand them out again
+    template<typename node_type>
+    class pool_allocator{
+
+    private:
+
+        static const size_t slab_size = 1024; //Nodes per slab
+
+        //A slot either holds a live node or links to the next free slot
+        union slot{
+            slot* next;
+            alignas(node_type) unsigned char storage[sizeof(node_type)];
+        };
+
+        struct slab{
+            slab* next;
+            slot slots[slab_size];
+        };
+
+        //Freed with the last pool using it. Pools on different threads can reach the same arena, so all of it is behind lock
+        struct arena{
+            std::mutex lock;
+            std::vector<slab*> chains; //Slabs of pools that let go or were spliced away, each chain newest first
+            slot* returned = nullptr; //Free slots those pools left, given to the next pool here that runs out
+            slot* returned_tail = nullptr;
+            std::shared_ptr<arena> merged_into; //Set once a splice moved everything here into another arena
+            ~arena();
+        };
+
+        std::shared_ptr<arena> home; //Arena this pool's nodes are kept in, nullptr until the first slab
+        slab* newest; //Newest of the slabs only this pool adds to, each links to the one before. nullptr if none yet
+        slot* free_list; //Slots given back through deallocate
+        slot* free_tail; //Last slot on the free list, so lists can be linked behind it without walking them
+        size_t used; //How many slots of the newest slab have been handed out
+
+        static void link(slot*& head, slot*& tail, slot* more, slot* more_tail); //Puts the list more in front of the list at head
+        void push_free(slot* s); //Puts a slot at the front of the free list
+        void free_rest(); //Puts the slots of the newest slab not handed out yet on the free list
+        void refill(); //Takes the slots other pools gave back, or adds a slab if there are none
+        std::unique_lock<std::mutex> lock_home(); //Follows home past merged arenas and locks the one still in use
+        void merge_home(pool_allocator& b); //Makes this pool and b use the same arena, b's must exist
+        void reset(); //Back to an empty pool with no arena
+
+    public:
+        static const bool bulk_release = std::is_trivially_destructible<node_type>::value; //Safe to skip the tree walk while shared() is false
+
+        pool_allocator();
+        pool_allocator(const pool_allocator& b) = delete; //Each tree owns its own pool
+        pool_allocator& operator=(const pool_allocator& b) = delete;
+        ~pool_allocator();
+
+        template<typename... args> node_type* allocate(args&&... a); //Returns a node constructed from a, reusing a freed slot if there is one
+        void deallocate(node_type* n); //Destroys node and puts its slot on the free list
+        void release_all(); //Lets go of the arena, freeing it if no other pool uses it. Any node still in use is gone afterwards
+        void swap(pool_allocator& b); //Exchanges slabs with another pool, used by tree moves
+        void splice(pool_allocator& b); //Takes over everything of b, so nodes b handed out can be freed here. b is left empty
+        void share(pool_allocator& b); //Uses b's arena too, so nodes b handed out can be freed here. b keeps working as before
+        bool shared(); //True if another pool uses this pool's arena, the tree has to free every node before release_all then
+    };
+
+    //HEAP ALLOCATOR
+
+    template<typename node_type>
+    template<typename... args>
+    node_type* heap_allocator<node_type> :: allocate(args&&... a){
+        return new node_type(std::forward<args>(a)...);
+    }
+
+    template<typename node_type>
+    void heap_allocator<node_type> :: deallocate(node_type* n){
+        delete n;
+    }
+
+    template<typename node_type>
+    void heap_allocator<node_type> :: release_all(){
+        //Tree already freed every node one at a time
+    }
+
+    template<typename node_type>
+    void heap_allocator<node_type> :: swap(heap_allocator&){
+        //Stateless, nodes from one heap allocator can be freed by any other
+    }
+
+    template<typename node_type>
+    void heap_allocator<node_type> :: splice(heap_allocator&){
+        //Stateless, so nodes the other one handed out already belong to every heap allocator
+    }
+
+    template<typename node_type>
+    void heap_allocator<node_type> :: share(heap_allocator&){
+        //Stateless, same as splice
+    }
+
+    template<typename node_type>
+    bool heap_allocator<node_type> :: shared(){
+        return false;
+    }
+
+    //POOL ALLOCATOR
+
+    template<typename node_type>
+    pool_allocator<node_type> :: arena :: ~arena(){
+        for(slab* chain : chains){
+            while(chain){
+                slab* temp = chain;
+                chain = chain->next;
+                delete temp;
+            }
+        }
+    }
+
+    template<typename node_type>
+    pool_allocator<node_type> :: pool_allocator(){
+        newest = nullptr;
+        free_list = nullptr;
+        free_tail = nullptr;
+        used = slab_size; //Forces a refill on first allocate
+    }
+
+    template<typename node_type>
+    pool_allocator<node_type> :: ~pool_allocator(){
+        release_all();
+    }
+
+    template<typename node_type>
+    template<typename... args>
+    node_type* pool_allocator<node_type> :: allocate(args&&... a){
+        slot* s;
+
+        //Newest slab is full and nothing was freed, get more slots
+        if(!free_list && used == slab_size){
+            refill();
+        }
+
+        //Reuse a freed slot first so churn doesn't grow the pool
+        if(free_list){
+            s = free_list;
+            free_list = free_list->next;
+            if(!free_list){
+                free_tail = nullptr;
+            }
+        }
+        else{
+            s = &newest->slots[used];
+            used++;
+        }
+
+        //If the node constructor throws, slot goes on the free list instead of being lost
+        try{
+            return new (s->storage) node_type(std::forward<args>(a)...);
+        }
+        catch(...){
+            push_free(s);
+            throw;
+        }
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: deallocate(node_type* n){
+        //Run destructor, then the slot's memory becomes a free list link
+        n->~node_type();
+        push_free(reinterpret_cast<slot*>(n));
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: link(slot*& head, slot*& tail, slot* more, slot* more_tail){
+        //Tail of more is known, so this doesn't depend on either list's length
+        if(!more){
+            return;
+        }
+
+        more_tail->next = head;
+        if(!head){
+            tail = more_tail;
+        }
+        head = more;
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: push_free(slot* s){
+        //First slot on an empty list is also its last
+        if(!free_list){
+            free_tail = s;
+        }
+
+        s->next = free_list;
+        free_list = s;
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: free_rest(){
+        //Only the newest slab is tracked by used, so its untouched end would be lost otherwise
+        if(newest){
+            for(size_t i = used; i < slab_size; i++){
+                push_free(&newest->slots[i]);
+            }
+        }
+
+        used = slab_size;
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: refill(){
+        //Slots a pool gave back when it let go come first, so dropping a split half doesn't grow the other one
+        if(home){
+            std::unique_lock<std::mutex> held = lock_home();
+            if(home->returned){
+                free_list = home->returned;
+                free_tail = home->returned_tail;
+                home->returned = nullptr;
+                home->returned_tail = nullptr;
+                return;
+            }
+        }
+        else{
+            home = std::make_shared<arena>();
+        }
+
+        //No other pool adds to this pool's slabs, so the new one needs no lock
+        slab* fresh = new slab;
+        fresh->next = newest;
+        newest = fresh;
+        used = 0;
+    }
+
+    template<typename node_type>
+    std::unique_lock<std::mutex> pool_allocator<node_type> :: lock_home(){
+        //A splice on another pool can merge home into a different arena, so follow it to the one still in use
+        while(true){
+            std::shared_ptr<arena> next;
+            {
+                std::unique_lock<std::mutex> held(home->lock);
+                if(!home->merged_into){
+                    return held;
+                }
+                next = home->merged_into;
+            }
+            home = next;
+        }
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: merge_home(pool_allocator& b){
+        //No arena here yet, so b's can be used as it is
+        if(!home){
+            b.lock_home();
+            home = b.home;
+            return;
+        }
+
+        while(true){
+            lock_home();
+            b.lock_home();
+            if(home == b.home){
+                return;
+            }
+
+            //Both are checked again once both are locked, another thread may have merged one of them in between
+            std::shared_ptr<arena> theirs = b.home;
+            {
+                std::unique_lock<std::mutex> mine_held(home->lock, std::defer_lock);
+                std::unique_lock<std::mutex> theirs_held(theirs->lock, std::defer_lock);
+                std::lock(mine_held, theirs_held);
+                if(home->merged_into || theirs->merged_into){
+                    continue;
+                }
+
+                //Pools still on b's arena find everything here through merged_into
+                home->chains.insert(home->chains.end(), theirs->chains.begin(), theirs->chains.end());
+                theirs->chains.clear();
+                link(home->returned, home->returned_tail, theirs->returned, theirs->returned_tail);
+                theirs->returned = nullptr;
+                theirs->returned_tail = nullptr;
+                theirs->merged_into = home;
+            }
+
+            b.home = home;
+            return;
+        }
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: reset(){
+        home.reset();
+        newest = nullptr;
+        free_list = nullptr;
+        free_tail = nullptr;
+        used = slab_size;
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: release_all(){
+        //Only the arena is let go here, caller must have destroyed nodes that need it
+        if(home){
+            std::unique_lock<std::mutex> held = lock_home();
+
+            //Other pools may have nodes in this pool's slabs, so the arena keeps them
+            if(newest){
+                home->chains.push_back(newest);
+            }
+
+            //Tree gave every node back first since shared() was true, so every slot here is free for the others
+            if(home.use_count() > 1){
+                free_rest();
+                link(home->returned, home->returned_tail, free_list, free_tail);
+            }
+        }
+
+        reset();
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: swap(pool_allocator& b){
+        home.swap(b.home);
+        std::swap(newest, b.newest);
+        std::swap(free_list, b.free_list);
+        std::swap(free_tail, b.free_tail);
+        std::swap(used, b.used);
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: splice(pool_allocator& b){
+        //b never handed out a node, so there is nothing to take over
+        if(!b.home){
+            return;
+        }
+
+        //Nothing here yet, so b's pool can just move over
+        if(!home){
+            swap(b);
+            return;
+        }
+
+        merge_home(b);
+
+        b.free_rest();
+        link(free_list, free_tail, b.free_list, b.free_tail);
+
+        //Pools still sharing b's slabs may have nodes in them, so they go to the arena rather than into our own
+        if(b.newest){
+            std::unique_lock<std::mutex> held = lock_home();
+            home->chains.push_back(b.newest);
+        }
+
+        b.reset();
+    }
+
+    template<typename node_type>
+    void pool_allocator<node_type> :: share(pool_allocator& b){
+        //b never handed out a node, so there is nothing to share
+        if(!b.home){
+            return;
+        }
+
+        //Free lists and slabs stay apart, so each pool still hands out every slot once and only adds to its own slabs
+        merge_home(b);
+    }
+
+    template<typename node_type>
+    bool pool_allocator<node_type> :: shared(){
+        if(!home){
+            return false;
+        }
+
+        //Counted with the arena locked, so a merge can't move home while it is looked at
+        std::unique_lock<std::mutex> held = lock_home();
+        return home.use_count() > 1;
+    }
+}
+
+#endif
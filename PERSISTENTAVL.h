@@ -0,0 +1,561 @@
+#ifndef PERSISTENTAVL_H_INCLUDED
+#define PERSISTENTAVL_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <stdexcept> //For exceptions
+#include <vector> //For in-order walks
+#include <atomic> //For node reference counts
+#include <utility> //For std::move
+#include "COMPARATOR.h" //For key comparators
+
+namespace cop3530{
+
+    //Persistent AVL tree, snapshot() hands out an immutable version in O(1)
+    //Nodes are reference counted and shared between the tree and its snapshots. A write copies only the nodes
+    //on its path that something else still points to, so with no snapshots alive it changes nodes in place
+    //like AVL, and with snapshots alive it copies O(log n) nodes and leaves every snapshot untouched
+    //The tree itself is for one writer at a time. Snapshots can be read, copied and dropped from any thread
+    template<typename key_type, typename value_type, typename comparator = three_way_compare<key_type>>
+    class basic_PERSISTENTAVL{
+
+    private:
+
+        struct node{
+            key_type key;
+            value_type value;
+            node* left;
+            node* right;
+            int height; //Cached height of the subtree rooted here, a leaf is 1
+            size_t count; //Number of nodes in the subtree rooted here
+            std::atomic<size_t> refs; //Parents, trees and snapshots pointing here
+
+            node(const key_type& k, const value_type& v) : key(k), value(v), left(nullptr), right(nullptr), height(1), count(1), refs(1) {}
+        };
+
+        node* root;
+
+        static int compare_keys(const key_type& a, const key_type& b); //One three-way comparison, negative if a < b, 0 if equal
+        static size_t get_size(const node* curr); //Returns cached size of a subtree, 0 for nullptr
+        static int get_height(const node* curr); //Returns cached height of a subtree, 0 for nullptr
+        static int get_balance(const node* curr); //Returns the balance factor for a subtree
+        static void update_node(node* curr); //Recomputes cached height and size of a node from its children
+        static node* retain(node* curr); //Adds a reference, returns curr
+        static void release(node* curr); //Drops a reference, frees the node and releases its children on the last one
+        static const node* find_node(const node* curr, const key_type& k); //Plain descent
+
+        //Helpers below take over the reference they are given and return a reference for the same slot
+        static node* unshare(node* curr); //Returns curr if nothing else points to it, otherwise a copy sharing its children
+        static node* rotate_left(node* curr); //Rotates an unshared subtree counterclockwise, returns new root
+        static node* rotate_right(node* curr); //Rotates an unshared subtree clockwise, returns new root
+        static node* rebalance(node* curr); //Fixes balance of an unshared node whose children just changed
+        static node* insert_copy(node* curr, const key_type& k, const value_type& v); //Inserts or overwrites k, key may or may not be there
+        static node* delete_copy(node* curr, const key_type& k); //Removes k, key must be there
+        static node* remove_min(node* curr, node*& min); //Takes smallest node out of a subtree, min gets the reference to it
+
+    public:
+        //Immutable version of the tree. Costs one reference count to make, copy or drop,
+        //and stays the same no matter what the tree does afterwards. Reads need no locks
+        class view{
+
+        private:
+            friend class basic_PERSISTENTAVL;
+
+            node* root;
+
+            view(node* r) : root(retain(r)) {}
+
+        public:
+            view() : root(nullptr) {}
+            view(const view& b) : root(retain(b.root)) {}
+            view(view&& b) : root(b.root) { b.root = nullptr; }
+            view& operator=(view b){ std::swap(root, b.root); return *this; }
+            ~view(){ release(root); }
+
+            const value_type& lookup(const key_type& k) const{
+                const node* found = find_node(root, k);
+                if(!found){
+                    throw std::runtime_error("Given key was not in the map to lookup");
+                }
+                return found->value;
+            }
+
+            const value_type* find(const key_type& k) const{
+                const node* found = find_node(root, k);
+                return found ? &found->value : nullptr;
+            }
+
+            bool contains(const key_type& k) const{ return find_node(root, k) != nullptr; }
+            bool is_empty() const{ return root == nullptr; }
+            size_t size() const{ return get_size(root); }
+            int height() const{ return get_height(root) - 1; }
+
+            //Calls f(key, value) on every pair in key order
+            template<typename function>
+            void for_each(function f) const{
+                std::vector<const node*> path;
+                const node* curr = root;
+                while(curr || !path.empty()){
+                    while(curr){
+                        path.push_back(curr);
+                        curr = curr->left;
+                    }
+                    curr = path.back();
+                    path.pop_back();
+                    f(curr->key, curr->value);
+                    curr = curr->right;
+                }
+            }
+        };
+
+        basic_PERSISTENTAVL();
+        basic_PERSISTENTAVL(const basic_PERSISTENTAVL& b); //O(1), shares every node with b
+        basic_PERSISTENTAVL& operator=(const basic_PERSISTENTAVL& b);
+        basic_PERSISTENTAVL(basic_PERSISTENTAVL&& b); //Move constructor
+        basic_PERSISTENTAVL& operator=(basic_PERSISTENTAVL&& b); //Move-assignment operator
+        explicit basic_PERSISTENTAVL(const view& s); //O(1), new tree starting from a snapshot's version
+        ~basic_PERSISTENTAVL();
+
+        void insert(const key_type& k, const value_type& v); //Adds k-v pair to map
+        bool try_insert(const key_type& k, const value_type& v); //Adds k-v pair if key is new, returns true if it was added
+        bool insert_or_assign(const key_type& k, const value_type& v); //Adds k-v pair or overwrites existing value, returns true if it was added
+        void remove(const key_type& k); //Removes k-v pair from map
+
+        //Values may be shared with snapshots, so they are only handed out as const. Change them with insert_or_assign
+        const value_type& lookup(const key_type& k); //Returns a reference to the value associated with given key
+        const value_type* find(const key_type& k); //Returns a pointer to the value associated with given key, nullptr if missing
+        value_type lookup_or(const key_type& k, const value_type& fallback); //Returns the value associated with given key, fallback if missing
+
+        bool contains(const key_type& k); //Returns true if tree contains value associated with key
+        bool is_empty(); //Returns true if tree is empty
+        size_t size(); //Returns all key value pairs in map
+        void clear(); //Removes all elements from map, snapshots keep theirs
+        int height(); //Returns tree's height
+        int balance(); //Returns tree's balance factor
+
+        view snapshot(); //O(1) immutable view of the tree as it is now
+    };
+
+    //Original interface, ordering comes from a pair of compare and equals functions
+    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
+    using PERSISTENTAVL = basic_PERSISTENTAVL<key_type, value_type, function_compare<key_type, compare, equals>>;
+
+    //CONSTRUCTORS AND DESTRUCTORS
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_PERSISTENTAVL<key_type, value_type, comparator> :: basic_PERSISTENTAVL(){
+        root = nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_PERSISTENTAVL<key_type, value_type, comparator> :: basic_PERSISTENTAVL(const basic_PERSISTENTAVL& b){ //Copy constructor
+        //Nothing is copied now, the first write to either tree copies just its own path
+        root = retain(b.root);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_PERSISTENTAVL<key_type, value_type, comparator>& basic_PERSISTENTAVL<key_type, value_type, comparator> :: operator=(const basic_PERSISTENTAVL& b){ //Copy assignment operator
+        //Retain first, so assigning a tree to itself doesn't free it
+        node* temp = retain(b.root);
+        release(root);
+        root = temp;
+        return *this;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_PERSISTENTAVL<key_type, value_type, comparator> :: basic_PERSISTENTAVL(basic_PERSISTENTAVL&& b){ //Move constructor
+        root = b.root;
+        b.root = nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_PERSISTENTAVL<key_type, value_type, comparator>& basic_PERSISTENTAVL<key_type, value_type, comparator> :: operator=(basic_PERSISTENTAVL&& b){ //Move assignment operator
+        if(this == &b){
+            return *this;
+        }
+
+        release(root);
+        root = b.root;
+        b.root = nullptr;
+        return *this;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_PERSISTENTAVL<key_type, value_type, comparator> :: basic_PERSISTENTAVL(const view& s){
+        root = retain(s.root);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_PERSISTENTAVL<key_type, value_type, comparator> :: ~basic_PERSISTENTAVL(){
+        //Only nodes no snapshot still uses are freed
+        release(root);
+    }
+
+    //HELPER FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_PERSISTENTAVL<key_type, value_type, comparator> :: compare_keys(const key_type& a, const key_type& b){
+        //Comparator is stateless, so a temporary is free and the call can be inlined
+        return comparator()(a, b);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_PERSISTENTAVL<key_type, value_type, comparator> :: get_size(const node* curr){
+        //Sizes are cached in each node, so this is constant time
+        if(!curr){
+            return 0;
+        }
+
+        return curr->count;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_PERSISTENTAVL<key_type, value_type, comparator> :: get_height(const node* curr){
+        //Heights are cached in each node, so this is constant time
+        if(!curr){
+            return 0;
+        }
+
+        return curr->height;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_PERSISTENTAVL<key_type, value_type, comparator> :: get_balance(const node* curr){
+        //If curr exists, then get balance factor for given node
+        if(curr){
+            return get_height(curr->left) - get_height(curr->right);
+        }
+
+        return 0;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_PERSISTENTAVL<key_type, value_type, comparator> :: update_node(node* curr){
+        //Height is taller child plus one, size is both children plus itself
+        int left_height = get_height(curr->left);
+        int right_height = get_height(curr->right);
+        curr->height = (left_height > right_height ? left_height : right_height) + 1;
+        curr->count = get_size(curr->left) + get_size(curr->right) + 1;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: retain(node* curr){
+        //New references only come from something that already holds one, so relaxed is enough
+        if(curr){
+            curr->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return curr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_PERSISTENTAVL<key_type, value_type, comparator> :: release(node* curr){
+        //Last reference frees the node, which drops its own references to the children
+        //Recursion only goes as deep as the tree, which is O(log n)
+        if(curr && curr->refs.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            release(curr->left);
+            release(curr->right);
+            delete curr;
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    const typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: find_node(const node* curr, const key_type& k){
+        while(curr){
+            int order = compare_keys(k, curr->key); //One comparison picks the branch
+            //Key matched node we are on
+            if(order == 0){
+                return curr;
+            }
+            //Key comes before node we are on, go left
+            else if(order < 0){
+                curr = curr->left;
+            }
+            //Go right
+            else{
+                curr = curr->right;
+            }
+        }
+
+        return nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: unshare(node* curr){
+        //Only reference is ours, nothing else can see a change. Acquire pairs with the release of
+        //whoever dropped the other references, so their reads are done before we write
+        if(curr->refs.load(std::memory_order_acquire) == 1){
+            return curr;
+        }
+
+        //Shared, so copy it. Copy points at the same children, which gain a reference
+        node* copy = new node(curr->key, curr->value);
+        copy->left = retain(curr->left);
+        copy->right = retain(curr->right);
+        copy->height = curr->height;
+        copy->count = curr->count;
+        release(curr); //Our reference moves from the original to the copy
+        return copy;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: rotate_left(node* curr){
+        //Same rotation as AVL, the child moving up is unshared first since its left pointer changes
+        node* temp = curr;
+        curr = unshare(curr->right);
+        temp->right = curr->left;
+        curr->left = temp;
+
+        //Old root is now the child, so its height and size must be fixed first
+        update_node(temp);
+        update_node(curr);
+        return curr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: rotate_right(node* curr){
+        //Same rotation as AVL, the child moving up is unshared first since its right pointer changes
+        node* temp = curr;
+        curr = unshare(curr->left);
+        temp->left = curr->right;
+        curr->right = temp;
+
+        //Old root is now the child, so its height and size must be fixed first
+        update_node(temp);
+        update_node(curr);
+        return curr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: rebalance(node* curr){
+        //Child's balance picks single or double rotation, same cases as AVL for both insert and delete
+        update_node(curr);
+        int bf = get_balance(curr);
+
+        //Left heavy, left right case rotates the child first
+        if(bf > 1){
+            if(get_balance(curr->left) < 0){
+                curr->left = rotate_left(unshare(curr->left));
+            }
+            return rotate_right(curr);
+        }
+
+        //Right heavy, right left case rotates the child first
+        if(bf < -1){
+            if(get_balance(curr->right) > 0){
+                curr->right = rotate_right(unshare(curr->right));
+            }
+            return rotate_left(curr);
+        }
+
+        return curr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: insert_copy(node* curr, const key_type& k, const value_type& v){
+        //Empty spot, new node is a leaf
+        if(!curr){
+            return new node(k, v);
+        }
+
+        //Every node on the path changes (value or child and cached fields), so each is unshared on the way down
+        curr = unshare(curr);
+        int order = compare_keys(k, curr->key); //One comparison picks the branch
+
+        //Key already in map, overwrite value
+        if(order == 0){
+            curr->value = v;
+            return curr;
+        }
+
+        //Key is less than current node, go left
+        if(order < 0){
+            curr->left = insert_copy(curr->left, k, v);
+        }
+        //Go right
+        else{
+            curr->right = insert_copy(curr->right, k, v);
+        }
+
+        return rebalance(curr);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: remove_min(node* curr, node*& min){
+        //Smallest node has no left child, its right subtree takes its place. min keeps our reference to it
+        if(!curr->left){
+            min = curr;
+            return retain(curr->right);
+        }
+
+        curr = unshare(curr);
+        curr->left = remove_min(curr->left, min);
+        return rebalance(curr);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: node* basic_PERSISTENTAVL<key_type, value_type, comparator> :: delete_copy(node* curr, const key_type& k){
+        curr = unshare(curr);
+        int order = compare_keys(k, curr->key); //One comparison picks the branch
+
+        if(order == 0){
+            //Zero or one child, child takes its place. Node gives up its child reference to the parent
+            if(!curr->left || !curr->right){
+                node* child = curr->left ? curr->left : curr->right;
+                curr->left = nullptr;
+                curr->right = nullptr;
+                release(curr);
+                return child;
+            }
+
+            //Two children, successor's key and value move into this node
+            node* min;
+            curr->right = remove_min(curr->right, min);
+            if(min->refs.load(std::memory_order_acquire) == 1){
+                curr->key = std::move(min->key);
+                curr->value = std::move(min->value);
+            }
+            else{
+                curr->key = min->key;
+                curr->value = min->value;
+            }
+            release(min);
+        }
+        //Key comes before node we are currently on, so go left
+        else if(order < 0){
+            curr->left = delete_copy(curr->left, k);
+        }
+        //Key greater than, go right
+        else{
+            curr->right = delete_copy(curr->right, k);
+        }
+
+        return rebalance(curr);
+    }
+
+    //PUBLIC FUNCTIONS
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_PERSISTENTAVL<key_type, value_type, comparator> :: insert(const key_type& k, const value_type& v){
+        //Key must not already be in map
+        if(!try_insert(k, v)){
+            throw std::runtime_error("Already contain that key");
+        }
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_PERSISTENTAVL<key_type, value_type, comparator> :: try_insert(const key_type& k, const value_type& v){
+        //Checked first, so a duplicate doesn't copy a path for nothing
+        if(find_node(root, k)){
+            return false;
+        }
+
+        root = insert_copy(root, k, v);
+        return true;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_PERSISTENTAVL<key_type, value_type, comparator> :: insert_or_assign(const key_type& k, const value_type& v){
+        //Both cases change the path, so one descent does either
+        size_t before = get_size(root);
+        root = insert_copy(root, k, v);
+        return get_size(root) != before;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_PERSISTENTAVL<key_type, value_type, comparator> :: remove(const key_type& k){
+        //Check if empty to avoid errors, then call recursive function to remove
+        if(is_empty()){
+            throw std::runtime_error("Cannot remove from an empty map");
+        }
+
+        if(!contains(k)){
+            throw std::runtime_error("Key is not in map");
+        }
+
+        root = delete_copy(root, k);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    const value_type& basic_PERSISTENTAVL<key_type, value_type, comparator> :: lookup(const key_type& k){
+        //Again check if empty and then go through tree looking for key
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        const node* found = find_node(root, k);
+
+        //No key was found, return error
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    const value_type* basic_PERSISTENTAVL<key_type, value_type, comparator> :: find(const key_type& k){
+        //Same walk as lookup, but a miss is reported with nullptr instead of an exception
+        const node* found = find_node(root, k);
+
+        if(!found){
+            return nullptr;
+        }
+
+        return &found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    value_type basic_PERSISTENTAVL<key_type, value_type, comparator> :: lookup_or(const key_type& k, const value_type& fallback){
+        //One descent, hands back a copy of fallback if key is missing
+        const node* found = find_node(root, k);
+
+        if(!found){
+            return fallback;
+        }
+
+        return found->value;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_PERSISTENTAVL<key_type, value_type, comparator> :: contains(const key_type& k){
+        //Same as lookup, just returning bool instead of value
+        return find_node(root, k) != nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_PERSISTENTAVL<key_type, value_type, comparator> :: is_empty(){
+        //Tree only empty if root doesnt exist
+        return root == nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_PERSISTENTAVL<key_type, value_type, comparator> :: size(){
+        //Root's cached size covers the whole tree
+        return get_size(root);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    void basic_PERSISTENTAVL<key_type, value_type, comparator> :: clear(){
+        //Drops this tree's reference, nodes still in a snapshot stay alive
+        release(root);
+        root = nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_PERSISTENTAVL<key_type, value_type, comparator> :: height(){
+        //Root's cached height minus 1 to get rid of counting root as 1
+        return get_height(root) - 1;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_PERSISTENTAVL<key_type, value_type, comparator> :: balance(){
+        return get_balance(root);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_PERSISTENTAVL<key_type, value_type, comparator> :: view basic_PERSISTENTAVL<key_type, value_type, comparator> :: snapshot(){
+        //Just one more reference to the root, the next write copies whatever it touches
+        return view(root);
+    }
+}
+
+#endif
@@ -0,0 +1,357 @@
+//Snapshot readers against a writer on PERSISTENTAVL, checked as well as timed
+//One writer keeps changing the tree and publishes a snapshot every so often. Reader threads take the newest one
+//and walk and search all of it while the writer goes on, checking it still holds what the tree held when it was taken.
+//Reports JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread PERSISTENTBENCHMARK.cpp -o persistentbenchmark
+//    ./persistentbenchmark > persistent.json
+//
+//Options:
+//    --size=100000               Keys in the tree before the writer starts, drawn from twice as many possible keys
+//    --writes=1000000            Writes the writer makes, a third each of inserts, overwrites and removes
+//    --every=10000               Writes between snapshots
+//    --readers=2                 Reader threads
+//    --seed=N                    Seed for keys and operations, default 12345
+//
+//The writer keeps a std::map next to the tree, and publishes every snapshot with the size and checksum the map had.
+//A reader checks the size, that for_each gives keys in order adding up to the checksum, and that find and lookup
+//agree with for_each on keys both in and out of the snapshot. The first snapshot is kept until every write is done
+//and then checked again. The writes are run once more with no snapshots, so write_ns_per_op shows what path copying
+//costs. With fewer cores than readers + 1 the writer also waits for readers, which shows up in it too (hardware_concurrency
+//is in the config). Any failure goes to stderr and exits with 1
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtoull and exit
+#include <cstring> //For parsing options
+#include <cstdint> //For checksums
+#include <vector> //For threads and writes
+#include <random> //For keys and operations
+#include <chrono> //For timing
+#include <thread> //For reader threads
+#include <atomic> //For the stop flag and counters
+#include <mutex> //For handing snapshots to readers
+#include <map> //For what every snapshot should hold
+#include <algorithm> //For searching a walked snapshot
+#include "PERSISTENTAVL.h"
+
+typedef uint64_t key_type;
+typedef uint64_t value_type;
+typedef cop3530::basic_PERSISTENTAVL<key_type, value_type> tree_type;
+
+//RUNNER
+
+struct options{
+    size_t size;
+    size_t writes;
+    size_t every;
+    size_t readers;
+    unsigned long long seed;
+};
+
+//Insert, overwrite or remove, made up front so both runs make the same writes
+struct write_op{
+    int kind;
+    key_type key;
+    value_type value;
+};
+
+//Newest snapshot and what it has to hold
+struct published{
+    std::mutex lock;
+    tree_type::view snap;
+    size_t size = 0;
+    uint64_t checksum = 0;
+    size_t version = 0; //0 until the first snapshot is out
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double seconds_since(bench_clock::time_point start){
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+static void fail(const char* what){
+    fprintf(stderr, "%s\n", what);
+    exit(1);
+}
+
+//Order doesn't matter to a sum, so the writer can keep it up to date one write at a time
+static uint64_t pair_sum(key_type k, value_type v){
+    return (k * 0x9E3779B97F4A7C15ull) ^ v;
+}
+
+static void check_snapshot(const tree_type::view& s, size_t size, uint64_t checksum, size_t key_space, std::mt19937_64& gen){
+    if(s.size() != size){
+        fail("snapshot has the wrong size");
+    }
+
+    std::vector<key_type> keys;
+    std::vector<value_type> values;
+    keys.reserve(size);
+    values.reserve(size);
+    uint64_t sum = 0;
+    s.for_each([&](const key_type& k, const value_type& v){
+        if(!keys.empty() && keys.back() >= k){
+            fail("snapshot walk is out of order");
+        }
+        keys.push_back(k);
+        values.push_back(v);
+        sum += pair_sum(k, v);
+    });
+
+    if(keys.size() != size || sum != checksum){
+        fail("snapshot doesn't hold what the tree held when it was taken");
+    }
+
+    //Half the probes are keys it has, the rest anything in the key space
+    for(int i = 0; i < 256; i++){
+        key_type k = (i % 2 == 0 && size > 0) ? keys[gen() % size] : gen() % key_space;
+        const value_type* found = s.find(k);
+        std::vector<key_type>::iterator at = std::lower_bound(keys.begin(), keys.end(), k);
+        bool walked = at != keys.end() && *at == k;
+
+        if((found != nullptr) != walked || s.contains(k) != walked){
+            fail("snapshot find disagrees with its walk");
+        }
+        if(walked && (*found != values[at - keys.begin()] || s.lookup(k) != *found)){
+            fail("snapshot lookup disagrees with its walk");
+        }
+    }
+}
+
+//Runs every write, publishing a snapshot to slot every opt.every of them if there is a slot. Returns seconds spent writing
+static double run_writer(tree_type& t, std::map<key_type, value_type>& mirror, uint64_t& checksum, const std::vector<write_op>& writes,
+                         const options& opt, published* slot, size_t& snapshots, double& snapshot_seconds){
+    double write_seconds = 0;
+    snapshots = 0;
+    snapshot_seconds = 0;
+
+    for(size_t i = 0; i < writes.size(); i += opt.every){
+        size_t stop = std::min(writes.size(), i + opt.every);
+
+        bench_clock::time_point start = bench_clock::now();
+        for(size_t j = i; j < stop; j++){
+            const write_op& w = writes[j];
+            if(w.kind == 0){
+                t.try_insert(w.key, w.value);
+            }
+            else if(w.kind == 1){
+                t.insert_or_assign(w.key, w.value);
+            }
+            else if(t.contains(w.key)){
+                t.remove(w.key);
+            }
+        }
+        write_seconds += seconds_since(start);
+
+        //Mirror is kept outside the timing, it only says what the snapshot should hold
+        for(size_t j = i; j < stop; j++){
+            const write_op& w = writes[j];
+            std::map<key_type, value_type>::iterator at = mirror.find(w.key);
+            if(w.kind == 0 && at == mirror.end()){
+                mirror.emplace(w.key, w.value);
+                checksum += pair_sum(w.key, w.value);
+            }
+            else if(w.kind == 1){
+                if(at != mirror.end()){
+                    checksum -= pair_sum(at->first, at->second);
+                    at->second = w.value;
+                }
+                else{
+                    mirror.emplace(w.key, w.value);
+                }
+                checksum += pair_sum(w.key, w.value);
+            }
+            else if(w.kind == 2 && at != mirror.end()){
+                checksum -= pair_sum(at->first, at->second);
+                mirror.erase(at);
+            }
+        }
+
+        if(slot){
+            start = bench_clock::now();
+            tree_type::view s = t.snapshot();
+            snapshot_seconds += seconds_since(start);
+            snapshots++;
+
+            std::lock_guard<std::mutex> guard(slot->lock);
+            slot->snap = std::move(s);
+            slot->size = mirror.size();
+            slot->checksum = checksum;
+            slot->version++;
+        }
+    }
+
+    return write_seconds;
+}
+
+static std::vector<write_op> make_writes(const options& opt, size_t key_space, std::mt19937_64& gen){
+    std::vector<write_op> writes(opt.writes);
+    for(size_t i = 0; i < opt.writes; i++){
+        writes[i].kind = (int)(gen() % 3);
+        writes[i].key = gen() % key_space;
+        writes[i].value = gen();
+    }
+    return writes;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.size = 100000;
+    opt.writes = 1000000;
+    opt.every = 10000;
+    opt.readers = 2;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--size=", 7) == 0){
+            opt.size = strtoull(arg + 7, nullptr, 10);
+        }
+        else if(strncmp(arg, "--writes=", 9) == 0){
+            opt.writes = strtoull(arg + 9, nullptr, 10);
+        }
+        else if(strncmp(arg, "--every=", 8) == 0){
+            opt.every = strtoull(arg + 8, nullptr, 10);
+        }
+        else if(strncmp(arg, "--readers=", 10) == 0){
+            opt.readers = strtoull(arg + 10, nullptr, 10);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.size == 0 || opt.every == 0){
+        fprintf(stderr, "Size and every must be at least 1\n");
+        exit(1);
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+    size_t key_space = opt.size * 2;
+
+    std::mt19937_64 gen(opt.seed);
+    std::vector<key_type> prefill;
+    while(prefill.size() < opt.size){
+        prefill.push_back(gen() % key_space);
+    }
+    std::vector<write_op> writes = make_writes(opt, key_space, gen);
+
+    printf("{\n  \"config\": {\"size\": %zu, \"writes\": %zu, \"every\": %zu, \"readers\": %zu, \"seed\": %llu, \"hardware_concurrency\": %u},\n  \"results\": [",
+           opt.size, opt.writes, opt.every, opt.readers, opt.seed, std::thread::hardware_concurrency());
+
+    //Same writes with nothing holding on to old versions, so nodes are changed in place
+    double alone_seconds;
+    {
+        tree_type t;
+        std::map<key_type, value_type> mirror;
+        uint64_t checksum = 0;
+        for(key_type k : prefill){
+            if(t.try_insert(k, k)){
+                mirror.emplace(k, k);
+                checksum += pair_sum(k, k);
+            }
+        }
+
+        size_t snapshots;
+        double snapshot_seconds;
+        alone_seconds = run_writer(t, mirror, checksum, writes, opt, nullptr, snapshots, snapshot_seconds);
+
+        if(t.size() != mirror.size()){
+            fail("tree lost or kept the wrong keys");
+        }
+    }
+    printf("\n    {\"phase\": \"no_snapshots\", \"write_ns_per_op\": %.2f}", opt.writes ? alone_seconds * 1e9 / opt.writes : 0.0);
+    fflush(stdout);
+
+    tree_type t;
+    std::map<key_type, value_type> mirror;
+    uint64_t checksum = 0;
+    for(key_type k : prefill){
+        if(t.try_insert(k, k)){
+            mirror.emplace(k, k);
+            checksum += pair_sum(k, k);
+        }
+    }
+
+    //First version is kept through every write after it, and checked at the end
+    tree_type::view first = t.snapshot();
+    size_t first_size = mirror.size();
+    uint64_t first_checksum = checksum;
+
+    published slot;
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned long long> checked(0);
+    std::atomic<unsigned long long> walked(0);
+    std::vector<std::thread> readers;
+
+    for(size_t i = 0; i < opt.readers; i++){
+        readers.emplace_back([&, i]{
+            std::mt19937_64 probe(opt.seed + 1 + i);
+            size_t seen = 0;
+
+            while(true){
+                //Checked once more after the writer is done, so the last snapshot is always read
+                bool last = stop.load();
+
+                tree_type::view s;
+                size_t size;
+                uint64_t sum;
+                size_t version;
+                {
+                    std::lock_guard<std::mutex> guard(slot.lock);
+                    s = slot.snap;
+                    size = slot.size;
+                    sum = slot.checksum;
+                    version = slot.version;
+                }
+
+                if(version != seen){
+                    check_snapshot(s, size, sum, key_space, probe);
+                    checked.fetch_add(1);
+                    walked.fetch_add(size);
+                    seen = version;
+                }
+                else if(!last){
+                    std::this_thread::yield();
+                }
+
+                if(last){
+                    break;
+                }
+            }
+        });
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+    size_t snapshots;
+    double snapshot_seconds;
+    double write_seconds = run_writer(t, mirror, checksum, writes, opt, &slot, snapshots, snapshot_seconds);
+    stop.store(true);
+    for(size_t i = 0; i < readers.size(); i++){
+        readers[i].join();
+    }
+    double total_seconds = seconds_since(start);
+
+    check_snapshot(first, first_size, first_checksum, key_space, gen);
+    if(t.size() != mirror.size()){
+        fail("tree lost or kept the wrong keys");
+    }
+
+    printf(",\n    {\"phase\": \"snapshots\", \"write_ns_per_op\": %.2f, \"snapshots\": %zu, \"snapshot_ns_per_op\": %.2f, \"snapshots_checked\": %llu, \"pairs_walked_per_sec\": %.0f, \"first_snapshot_checked\": true}",
+           opt.writes ? write_seconds * 1e9 / opt.writes : 0.0, snapshots, snapshots ? snapshot_seconds * 1e9 / snapshots : 0.0,
+           checked.load(), total_seconds > 0 ? walked.load() / total_seconds : 0.0);
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
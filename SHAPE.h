@@ -0,0 +1,149 @@
+#ifndef SHAPE_H_INCLUDED
+#define SHAPE_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <cstdint> //For path length sums
+#include <vector> //For histograms and the walk's stacks
+#include <algorithm> //For heap functions and max
+
+namespace cop3530{
+
+    //Shape reports for the pointer trees. Every tree's shape_report() hands its root to measure_shape,
+    //which walks each node once and works out everything below, so no part of it costs O(n) per node
+
+    //A subtree whose two sides differ in height, found by measure_shape
+    template<typename key_type>
+    struct shape_hot_spot{
+        key_type key; //Key at the subtree's root
+        size_t depth; //Depth of that root, the tree's root is depth 0
+        size_t size; //Nodes in the subtree
+        size_t left_height; //Levels on each side, an empty side is 0
+        size_t right_height;
+        size_t imbalance; //Difference between the two heights
+    };
+
+    template<typename key_type>
+    struct tree_shape{
+        size_t nodes = 0;
+        size_t levels = 0; //Levels in the tree, one more than height() unless the tree is empty
+        size_t minimum_levels = 0; //Levels a perfectly balanced tree with as many nodes would have
+        std::vector<size_t> level_nodes; //level_nodes[d] is how many nodes are at depth d
+        std::vector<size_t> leaf_depths; //Depth histogram of the leaves, leaf_depths[d] is how many nodes with no children are at depth d
+        uint64_t internal_path_length = 0; //Sum of every node's depth
+        uint64_t external_path_length = 0; //Sum of the depths of the n + 1 empty links, always internal_path_length + 2n
+        double average_path_length = 0; //Nodes a lookup of a key in the tree looks at, averaged over every key
+        double average_external_path = 0; //Nodes a missing lookup looks at, averaged over the n + 1 gaps between keys
+        std::vector<shape_hot_spot<key_type>> worst; //Most imbalanced subtrees, worst first. Ties go to the bigger subtree
+    };
+
+    //Walks the tree rooted at root once and reports its shape, keeping the worst most imbalanced subtrees
+    //node_type needs key, left and right. Walk uses its own stacks, so a degenerate tree doesn't overflow the call stack
+    template<typename key_type, typename node_type>
+    tree_shape<key_type> measure_shape(const node_type* root, size_t worst);
+
+    //True if a is a worse hot spot than b
+    template<typename key_type>
+    bool worse_spot(const shape_hot_spot<key_type>& a, const shape_hot_spot<key_type>& b){
+        if(a.imbalance != b.imbalance){
+            return a.imbalance > b.imbalance;
+        }
+
+        return a.size > b.size;
+    }
+
+    template<typename key_type, typename node_type>
+    tree_shape<key_type> measure_shape(const node_type* root, size_t worst){
+        //Post-order walk: a node is visited on the way down to count its level, and again after both children
+        //to combine their heights and sizes into its own. Empty links are walked too, they are the external path
+        struct frame{
+            const node_type* curr;
+            size_t depth;
+            bool children_done;
+        };
+
+        struct subtree{
+            size_t height;
+            size_t size;
+        };
+
+        tree_shape<key_type> report;
+        std::vector<frame> pending;
+        std::vector<subtree> done; //Results of finished subtrees, a node's left is below its right
+        pending.push_back({root, 0, false});
+
+        while(!pending.empty()){
+            frame f = pending.back();
+            pending.pop_back();
+
+            //Empty link, a missing key that lands here looks at f.depth nodes
+            if(!f.curr){
+                report.external_path_length += f.depth;
+                done.push_back({0, 0});
+                continue;
+            }
+
+            //First visit, count the node and come back after its children. Left is pushed last so it finishes first
+            if(!f.children_done){
+                if(report.level_nodes.size() <= f.depth){
+                    report.level_nodes.resize(f.depth + 1, 0);
+                }
+                report.level_nodes[f.depth]++;
+                report.internal_path_length += f.depth;
+                report.nodes++;
+
+                pending.push_back({f.curr, f.depth, true});
+                pending.push_back({f.curr->right, f.depth + 1, false});
+                pending.push_back({f.curr->left, f.depth + 1, false});
+                continue;
+            }
+
+            //Both children are done, right one is on top
+            subtree right = done.back();
+            done.pop_back();
+            subtree left = done.back();
+            done.pop_back();
+            done.push_back({std::max(left.height, right.height) + 1, left.size + right.size + 1});
+
+            if(left.height == 0 && right.height == 0){
+                if(report.leaf_depths.size() <= f.depth){
+                    report.leaf_depths.resize(f.depth + 1, 0);
+                }
+                report.leaf_depths[f.depth]++;
+            }
+
+            //Keep the worst spots in a heap with the least bad one on top, so a new spot only has to beat that one
+            size_t imbalance = left.height > right.height ? left.height - right.height : right.height - left.height;
+            if(worst > 0 && imbalance > 0){
+                shape_hot_spot<key_type> spot{f.curr->key, f.depth, left.size + right.size + 1, left.height, right.height, imbalance};
+                if(report.worst.size() < worst){
+                    report.worst.push_back(spot);
+                    std::push_heap(report.worst.begin(), report.worst.end(), worse_spot<key_type>);
+                }
+                else if(worse_spot(spot, report.worst.front())){
+                    std::pop_heap(report.worst.begin(), report.worst.end(), worse_spot<key_type>);
+                    report.worst.back() = spot;
+                    std::push_heap(report.worst.begin(), report.worst.end(), worse_spot<key_type>);
+                }
+            }
+        }
+
+        report.levels = report.level_nodes.size();
+        std::sort_heap(report.worst.begin(), report.worst.end(), worse_spot<key_type>);
+
+        //A perfect tree with h levels holds 2^h - 1 nodes
+        while(report.minimum_levels < 64 && ((uint64_t)1 << report.minimum_levels) - 1 < report.nodes){
+            report.minimum_levels++;
+        }
+
+        //A found key is compared at every level down to its own, one more than its depth
+        if(report.nodes > 0){
+            report.average_path_length = (double)(report.internal_path_length + report.nodes) / report.nodes;
+        }
+        report.average_external_path = (double)report.external_path_length / (report.nodes + 1);
+
+        return report;
+    }
+
+}
+
+#endif
@@ -0,0 +1,577 @@
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <stdexcept> //For exceptions
+#include <string> //For file paths
+#include <vector> //For the write buffer
+#include <cstdio> //For writing files
+#include <cstring> //For memcpy and memcmp
+#include <cstddef> //For max_align_t
+#include <cstdint> //For fixed width header fields
+#include <type_traits> //For checking keys and values can be stored as raw bytes
+#include <utility> //For std::pair
+#include "COMPARATOR.h" //For key comparators
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h> //For mmap
+#include <sys/stat.h> //For file sizes
+#include <fcntl.h> //For open
+#include <unistd.h> //For close
+#define SNAPSHOT_HAS_MMAP 1
+#endif
+
+namespace cop3530{
+
+    //Binary snapshot files, written by save() on the trees and read back by load() or by basic_SNAPSHOT
+    //
+    //Layout, all in the byte order of the machine that wrote it:
+    //    bytes 0-63      snapshot_header
+    //    keys_offset     count keys, sorted, as raw bytes
+    //    values_offset   count values in the same order, starts on a 64 byte boundary
+    //checksum covers every byte from keys_offset to the end of the file, padding included
+    //Only trivially copyable keys and values can be stored, since the file is their raw bytes
+
+    struct snapshot_header{
+        char magic[8]; //"COPSNAP" plus a 0
+        uint32_t version; //Format version, bumped on any layout change
+        uint32_t byte_order; //0x01020304 as written, reads as something else on a machine of the other endianness
+        uint64_t count; //Pairs in the file
+        uint32_t key_size; //sizeof the key type that wrote it
+        uint32_t value_size; //sizeof the value type that wrote it
+        uint64_t keys_offset;
+        uint64_t values_offset;
+        uint64_t checksum;
+        unsigned char reserved[8]; //Zero, pads the header to 64 bytes
+    };
+
+    static_assert(sizeof(snapshot_header) == 64, "Snapshot header must stay 64 bytes");
+
+    static const char snapshot_magic[8] = {'C', 'O', 'P', 'S', 'N', 'A', 'P', 0};
+    static const uint32_t snapshot_version = 1;
+    static const uint32_t snapshot_byte_order = 0x01020304;
+    static const size_t snapshot_alignment = 64; //Arrays start on cache line boundaries
+
+    //64-bit FNV-1a over 8 byte words instead of single bytes, fast enough to check a file on every load
+    class snapshot_checksum{
+
+    private:
+        uint64_t state;
+        unsigned char pending[8]; //Bytes of a word not finished yet
+        size_t used;
+        uint64_t length;
+
+        void mix(uint64_t word);
+
+    public:
+        snapshot_checksum();
+
+        void add(const void* data, size_t n); //Feeds n more bytes
+        uint64_t finish(); //Checksum of everything added
+    };
+
+    //Writes a snapshot to path from n sorted pairs, it->key and it->value are read twice (keys, then values)
+    //Goes to path.tmp first and is renamed over path at the end, so a crash never leaves half a file behind
+    template<typename key_type, typename value_type, typename entry_iterator>
+    void write_snapshot(const std::string& path, entry_iterator first, size_t n);
+
+    //Whole file readable in memory. Mapped where mmap exists, so nothing is read until it is touched,
+    //otherwise read into a buffer
+    class mapped_file{
+
+    private:
+        const unsigned char* bytes;
+        size_t length;
+        bool mapped; //Unmap instead of delete when done
+
+    public:
+        explicit mapped_file(const std::string& path);
+        mapped_file(const mapped_file& b) = delete;
+        mapped_file& operator=(const mapped_file& b) = delete;
+        ~mapped_file();
+
+        const unsigned char* data() const{ return bytes; }
+        size_t size() const{ return length; }
+    };
+
+    //Read-only map served straight from a snapshot file, nothing is copied out or built
+    //Lookups binary search the mapped keys, so a fresh process only reads the pages its lookups touch
+    //References handed out point into the mapping and stay valid as long as this object does
+    template<typename key_type, typename value_type, typename comparator = three_way_compare<key_type>>
+    class basic_SNAPSHOT{
+
+    private:
+
+        static_assert(std::is_trivially_copyable<key_type>::value && std::is_trivially_copyable<value_type>::value, "Snapshots store raw bytes, so keys and values must be trivially copyable");
+
+        mapped_file file;
+        const key_type* keys;
+        const value_type* values;
+        size_t count;
+
+        static int compare_keys(const key_type& a, const key_type& b); //One three-way comparison, negative if a < b, 0 if equal
+        size_t search(const key_type& k) const; //Index of the first key not less than k, count if there is none
+
+    public:
+        //Key-value pair handed out by iterators, both are const since the file never changes
+        struct entry{
+            const key_type& key;
+            const value_type& value;
+        };
+
+        //Random access would be easy, but bidirectional matches the trees and is all load needs
+        class iterator{
+
+        private:
+            friend class basic_SNAPSHOT;
+
+            //Lets it->key and it->value work even though entries are made on the fly
+            struct arrow{
+                entry e;
+                const entry* operator->() const{ return &e; }
+            };
+
+            const basic_SNAPSHOT* map;
+            size_t index;
+
+            iterator(const basic_SNAPSHOT* m, size_t i) : map(m), index(i) {}
+
+        public:
+            iterator() : map(nullptr), index(0) {}
+
+            entry operator*() const{ return entry{map->keys[index], map->values[index]}; }
+            arrow operator->() const{ return arrow{**this}; }
+
+            iterator& operator++(){ index++; return *this; }
+            iterator& operator--(){ index--; return *this; }
+            iterator operator++(int){ iterator temp = *this; index++; return temp; }
+            iterator operator--(int){ iterator temp = *this; index--; return temp; }
+
+            bool operator==(const iterator& b) const{ return index == b.index; }
+            bool operator!=(const iterator& b) const{ return index != b.index; }
+        };
+
+        //Same pairs as iterator, but as it->first and it->second for build_from_sorted
+        class pair_iterator{
+
+        private:
+            friend class basic_SNAPSHOT;
+
+            struct arrow{
+                std::pair<const key_type&, const value_type&> p;
+                const std::pair<const key_type&, const value_type&>* operator->() const{ return &p; }
+            };
+
+            const basic_SNAPSHOT* map;
+            size_t index;
+
+            pair_iterator(const basic_SNAPSHOT* m, size_t i) : map(m), index(i) {}
+
+        public:
+            arrow operator->() const{ return arrow{std::pair<const key_type&, const value_type&>(map->keys[index], map->values[index])}; }
+
+            pair_iterator& operator++(){ index++; return *this; }
+
+            bool operator==(const pair_iterator& b) const{ return index == b.index; }
+            bool operator!=(const pair_iterator& b) const{ return index != b.index; }
+        };
+
+        explicit basic_SNAPSHOT(const std::string& path, bool verify = true); //Opens and checks the header. verify also checks the checksum, which reads every page once
+
+        const value_type& lookup(const key_type& k) const; //Returns a reference to the value associated with given key
+        const value_type* find(const key_type& k) const; //Returns a pointer to the value associated with given key, nullptr if missing
+        value_type lookup_or(const key_type& k, const value_type& fallback) const; //Returns the value associated with given key, fallback if missing
+        bool contains(const key_type& k) const; //Returns true if map contains value associated with key
+        bool is_empty() const; //Returns true if map is empty
+        size_t size() const; //Returns all key value pairs in map
+
+        iterator begin() const; //Iterator to smallest key
+        iterator end() const; //Iterator past the largest key
+        iterator lower_bound(const key_type& k) const; //Iterator to first key not less than k
+        iterator upper_bound(const key_type& k) const; //Iterator to first key greater than k
+
+        pair_iterator pairs_begin() const; //Pairs as it->first and it->second, for build_from_sorted
+        pair_iterator pairs_end() const;
+    };
+
+    //Original interface, ordering comes from a pair of compare and equals functions
+    template<typename key_type, typename value_type, bool (*compare)(key_type, key_type), bool (*equals)(key_type, key_type)>
+    using SNAPSHOT = basic_SNAPSHOT<key_type, value_type, function_compare<key_type, compare, equals>>;
+
+    //CHECKSUM
+
+    inline snapshot_checksum :: snapshot_checksum(){
+        state = 14695981039346656037ull;
+        used = 0;
+        length = 0;
+    }
+
+    inline void snapshot_checksum :: mix(uint64_t word){
+        state ^= word;
+        state *= 1099511628211ull;
+    }
+
+    inline void snapshot_checksum :: add(const void* data, size_t n){
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        length += n;
+
+        //Finish a word started by an earlier call first
+        while(used > 0 && n > 0){
+            pending[used++] = *p++;
+            n--;
+            if(used == 8){
+                uint64_t word;
+                memcpy(&word, pending, 8);
+                mix(word);
+                used = 0;
+            }
+        }
+
+        //Whole words straight from the input
+        while(n >= 8){
+            uint64_t word;
+            memcpy(&word, p, 8);
+            mix(word);
+            p += 8;
+            n -= 8;
+        }
+
+        while(n > 0){
+            pending[used++] = *p++;
+            n--;
+        }
+    }
+
+    inline uint64_t snapshot_checksum :: finish(){
+        //Leftover bytes are zero padded into one last word, then the length goes in so padding can't collide
+        if(used > 0){
+            uint64_t word = 0;
+            memcpy(&word, pending, used);
+            mix(word);
+        }
+
+        mix(length);
+        return state;
+    }
+
+    //WRITING
+
+    template<typename key_type, typename value_type, typename entry_iterator>
+    void write_snapshot(const std::string& path, entry_iterator first, size_t n){
+        static_assert(std::is_trivially_copyable<key_type>::value && std::is_trivially_copyable<value_type>::value, "Snapshots store raw bytes, so keys and values must be trivially copyable");
+
+        snapshot_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+        header.version = snapshot_version;
+        header.byte_order = snapshot_byte_order;
+        header.count = n;
+        header.key_size = sizeof(key_type);
+        header.value_size = sizeof(value_type);
+        header.keys_offset = sizeof(snapshot_header);
+
+        uint64_t keys_end = header.keys_offset + (uint64_t)n * sizeof(key_type);
+        header.values_offset = (keys_end + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+
+        std::string temp_path = path + ".tmp";
+        FILE* out = fopen(temp_path.c_str(), "wb");
+        if(!out){
+            throw std::runtime_error("Cannot open snapshot file for writing");
+        }
+
+        //Everything goes through one buffer that is hashed and written as it fills
+        std::vector<unsigned char> buffer;
+        buffer.reserve(1 << 16);
+        snapshot_checksum checksum;
+        bool failed = false;
+
+        auto flush = [&](){
+            checksum.add(buffer.data(), buffer.size());
+            if(fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()){
+                failed = true;
+            }
+            buffer.clear();
+        };
+
+        auto append = [&](const void* p, size_t bytes){
+            if(buffer.size() + bytes > buffer.capacity()){
+                flush();
+            }
+            const unsigned char* b = static_cast<const unsigned char*>(p);
+            buffer.insert(buffer.end(), b, b + bytes);
+        };
+
+        //Header is rewritten once the checksum is known
+        if(fwrite(&header, sizeof(header), 1, out) != 1){
+            failed = true;
+        }
+
+        entry_iterator it = first;
+        for(size_t i = 0; i < n; i++, ++it){
+            append(&it->key, sizeof(key_type));
+        }
+
+        static const unsigned char zeros[snapshot_alignment] = {};
+        append(zeros, header.values_offset - keys_end);
+
+        it = first;
+        for(size_t i = 0; i < n; i++, ++it){
+            append(&it->value, sizeof(value_type));
+        }
+        flush();
+
+        header.checksum = checksum.finish();
+        if(fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, out) != 1){
+            failed = true;
+        }
+
+        if(fclose(out) != 0 || failed){
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Cannot write snapshot file");
+        }
+
+        if(std::rename(temp_path.c_str(), path.c_str()) != 0){
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Cannot replace snapshot file");
+        }
+    }
+
+    //MAPPED FILE
+
+    inline mapped_file :: mapped_file(const std::string& path){
+        bytes = nullptr;
+        length = 0;
+        mapped = false;
+
+#if defined(SNAPSHOT_HAS_MMAP)
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0){
+            throw std::runtime_error("Cannot open snapshot file");
+        }
+
+        struct stat info;
+        if(fstat(fd, &info) != 0){
+            close(fd);
+            throw std::runtime_error("Cannot open snapshot file");
+        }
+        length = (size_t)info.st_size;
+
+        //Empty files can't be mapped, the header check below turns them down anyway
+        if(length > 0){
+            void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p == MAP_FAILED){
+                close(fd);
+                throw std::runtime_error("Cannot map snapshot file");
+            }
+            bytes = static_cast<const unsigned char*>(p);
+            mapped = true;
+        }
+
+        //Mapping keeps its own reference to the file
+        close(fd);
+#else
+        FILE* in = fopen(path.c_str(), "rb");
+        if(!in){
+            throw std::runtime_error("Cannot open snapshot file");
+        }
+
+        fseek(in, 0, SEEK_END);
+        long end = ftell(in);
+        fseek(in, 0, SEEK_SET);
+        if(end < 0){
+            fclose(in);
+            throw std::runtime_error("Cannot read snapshot file");
+        }
+        length = (size_t)end;
+
+        //max_align_t blocks so the arrays inside are aligned like they would be in a mapping
+        std::max_align_t* buffer = new std::max_align_t[length / sizeof(std::max_align_t) + 1];
+        if(fread(buffer, 1, length, in) != length){
+            delete[] buffer;
+            fclose(in);
+            throw std::runtime_error("Cannot read snapshot file");
+        }
+        fclose(in);
+        bytes = reinterpret_cast<const unsigned char*>(buffer);
+#endif
+    }
+
+    inline mapped_file :: ~mapped_file(){
+#if defined(SNAPSHOT_HAS_MMAP)
+        if(mapped){
+            munmap(const_cast<unsigned char*>(bytes), length);
+        }
+#else
+        delete[] reinterpret_cast<const std::max_align_t*>(bytes);
+#endif
+    }
+
+    //MAPPED MAP
+
+    template<typename key_type, typename value_type, typename comparator>
+    basic_SNAPSHOT<key_type, value_type, comparator> :: basic_SNAPSHOT(const std::string& path, bool verify) : file(path){
+        //Every field is checked against the file size before anything is read through it
+        snapshot_header header;
+
+        if(file.size() < sizeof(header)){
+            throw std::runtime_error("Snapshot file is too short");
+        }
+        memcpy(&header, file.data(), sizeof(header));
+
+        if(memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0){
+            throw std::runtime_error("Not a snapshot file");
+        }
+        if(header.byte_order != snapshot_byte_order){
+            throw std::runtime_error("Snapshot file was written on a machine with the other byte order");
+        }
+        if(header.version != snapshot_version){
+            throw std::runtime_error("Snapshot file version is not supported");
+        }
+        if(header.key_size != sizeof(key_type) || header.value_size != sizeof(value_type)){
+            throw std::runtime_error("Snapshot file holds different key or value types");
+        }
+
+        //count is bounded by division first, so none of the sums below can overflow
+        uint64_t room = file.size();
+        if(header.keys_offset != sizeof(header) || header.count > (room - sizeof(header)) / sizeof(key_type)){
+            throw std::runtime_error("Snapshot file is truncated or corrupt");
+        }
+
+        uint64_t keys_end = header.keys_offset + header.count * sizeof(key_type);
+        uint64_t values_offset = (keys_end + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+        if(header.values_offset != values_offset || values_offset > room || room - values_offset != header.count * sizeof(value_type)){
+            throw std::runtime_error("Snapshot file is truncated or corrupt");
+        }
+
+        if(verify){
+            snapshot_checksum checksum;
+            checksum.add(file.data() + header.keys_offset, file.size() - header.keys_offset);
+            if(checksum.finish() != header.checksum){
+                throw std::runtime_error("Snapshot file checksum does not match");
+            }
+        }
+
+        keys = reinterpret_cast<const key_type*>(file.data() + header.keys_offset);
+        values = reinterpret_cast<const value_type*>(file.data() + header.values_offset);
+        count = header.count;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    int basic_SNAPSHOT<key_type, value_type, comparator> :: compare_keys(const key_type& a, const key_type& b){
+        //Comparator is stateless, so a temporary is free and the call can be inlined
+        return comparator()(a, b);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_SNAPSHOT<key_type, value_type, comparator> :: search(const key_type& k) const{
+        //Binary search that halves a range instead of branching on the result, so it compiles to conditional moves
+        if(count == 0){
+            return 0;
+        }
+
+        const key_type* base = keys;
+        size_t n = count;
+
+        while(n > 1){
+            size_t half = n / 2;
+            if(compare_keys(base[half - 1], k) < 0){
+                base += half;
+            }
+            n -= half;
+        }
+
+        return (base - keys) + (compare_keys(*base, k) < 0);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    const value_type& basic_SNAPSHOT<key_type, value_type, comparator> :: lookup(const key_type& k) const{
+        //Same errors as the trees
+        if(is_empty()){
+            throw std::runtime_error("Cannot lookup in an empty map");
+        }
+
+        const value_type* found = find(k);
+
+        if(!found){
+            throw std::runtime_error("Given key was not in the map to lookup");
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    const value_type* basic_SNAPSHOT<key_type, value_type, comparator> :: find(const key_type& k) const{
+        size_t i = search(k);
+
+        if(i == count || compare_keys(k, keys[i]) != 0){
+            return nullptr;
+        }
+
+        return values + i;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    value_type basic_SNAPSHOT<key_type, value_type, comparator> :: lookup_or(const key_type& k, const value_type& fallback) const{
+        const value_type* found = find(k);
+
+        if(!found){
+            return fallback;
+        }
+
+        return *found;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_SNAPSHOT<key_type, value_type, comparator> :: contains(const key_type& k) const{
+        return find(k) != nullptr;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    bool basic_SNAPSHOT<key_type, value_type, comparator> :: is_empty() const{
+        return count == 0;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    size_t basic_SNAPSHOT<key_type, value_type, comparator> :: size() const{
+        return count;
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_SNAPSHOT<key_type, value_type, comparator> :: iterator basic_SNAPSHOT<key_type, value_type, comparator> :: begin() const{
+        return iterator(this, 0);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_SNAPSHOT<key_type, value_type, comparator> :: iterator basic_SNAPSHOT<key_type, value_type, comparator> :: end() const{
+        return iterator(this, count);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_SNAPSHOT<key_type, value_type, comparator> :: iterator basic_SNAPSHOT<key_type, value_type, comparator> :: lower_bound(const key_type& k) const{
+        return iterator(this, search(k));
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_SNAPSHOT<key_type, value_type, comparator> :: iterator basic_SNAPSHOT<key_type, value_type, comparator> :: upper_bound(const key_type& k) const{
+        //Step over the key itself if it's there
+        size_t i = search(k);
+
+        if(i < count && compare_keys(k, keys[i]) == 0){
+            i++;
+        }
+
+        return iterator(this, i);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_SNAPSHOT<key_type, value_type, comparator> :: pair_iterator basic_SNAPSHOT<key_type, value_type, comparator> :: pairs_begin() const{
+        return pair_iterator(this, 0);
+    }
+
+    template<typename key_type, typename value_type, typename comparator>
+    typename basic_SNAPSHOT<key_type, value_type, comparator> :: pair_iterator basic_SNAPSHOT<key_type, value_type, comparator> :: pairs_end() const{
+        return pair_iterator(this, count);
+    }
+}
+
+#endif
@@ -0,0 +1,181 @@
+//Restart benchmark for snapshot files: rebuilding an AVL by inserts against save, load and serving from the mapping
+//Every phase is timed once per size and reported as JSON
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread SNAPSHOTBENCHMARK.cpp -o snapshotbenchmark
+//    ./snapshotbenchmark > snapshot.json
+//
+//Options:
+//    --sizes=1000000,10000000    Pairs in the map, default is those
+//    --queries=N                 Random hit lookups timed against the tree and the mapping, default 1000000
+//    --path=FILE                 Where the snapshot is written, default snapshot.bin in the current directory
+//    --seed=N                    Seed for keys and queries, default 12345
+//
+//Phases: insert (random order, what a restart does today), save, load (header, checksum and linear build_from_sorted),
+//open (map and check the checksum), open_unverified (map only), then lookups through the loaded tree and through the mapping.
+//The file was just written, so it is in the page cache and open/load don't include disk reads
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf and remove
+#include <cstdlib> //For strtoull
+#include <cstring> //For parsing options
+#include <cstdint> //For 8 byte keys
+#include <vector> //For keys and queries
+#include <random> //For keys and queries
+#include <chrono> //For timing
+#include <algorithm> //For shuffling
+#include <string> //For the file path
+#include "AVL.h"
+#include "SNAPSHOT.h"
+
+typedef uint64_t key_type;
+typedef uint64_t value_type;
+typedef cop3530::basic_AVL<key_type, value_type> tree_type;
+typedef cop3530::basic_SNAPSHOT<key_type, value_type> snapshot_type;
+
+//RUNNER
+
+struct options{
+    std::vector<size_t> sizes;
+    size_t queries;
+    std::string path;
+    unsigned long long seed;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+static double seconds_since(bench_clock::time_point start){
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+static void report(const char* phase, size_t size, size_t ops, double seconds, unsigned long long checksum){
+    printf("%s\n    {\"phase\": \"%s\", \"size\": %zu, \"ops\": %zu, \"seconds\": %.4f, \"ns_per_op\": %.2f, \"checksum\": %llu}",
+           first_result ? "" : ",", phase, size, ops, seconds, ops ? seconds * 1e9 / ops : 0.0, checksum);
+    first_result = false;
+    fflush(stdout);
+}
+
+static void run_size(size_t size, const options& opt){
+    std::mt19937_64 gen(opt.seed + size);
+    std::vector<key_type> keys(size);
+    for(size_t i = 0; i < size; i++){
+        keys[i] = (gen() & 0xffffffff00000000ull) | i; //Low bits make every key distinct
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    std::vector<key_type> queries(opt.queries);
+    for(size_t i = 0; i < opt.queries; i++){
+        queries[i] = keys[gen() % size];
+    }
+
+    unsigned long long checksum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    {
+        tree_type t;
+        for(key_type k : keys){
+            t.insert(k, k);
+        }
+        report("insert", size, size, seconds_since(start), t.size());
+
+        start = bench_clock::now();
+        t.save(opt.path);
+        report("save", size, size, seconds_since(start), t.size());
+    }
+
+    {
+        start = bench_clock::now();
+        tree_type t;
+        t.load(opt.path);
+        report("load", size, size, seconds_since(start), t.size());
+
+        checksum = 0;
+        start = bench_clock::now();
+        for(key_type k : queries){
+            checksum += *t.find(k);
+        }
+        report("tree_lookup", size, queries.size(), seconds_since(start), checksum);
+    }
+
+    {
+        start = bench_clock::now();
+        snapshot_type s(opt.path);
+        report("open", size, size, seconds_since(start), s.size());
+    }
+
+    start = bench_clock::now();
+    snapshot_type s(opt.path, false);
+    report("open_unverified", size, size, seconds_since(start), s.size());
+
+    //Checksums match tree_lookup when the mapping answers the same
+    checksum = 0;
+    start = bench_clock::now();
+    for(key_type k : queries){
+        checksum += *s.find(k);
+    }
+    report("mapped_lookup", size, queries.size(), seconds_since(start), checksum);
+}
+
+template<typename number>
+static std::vector<number> parse_list(const char* p){
+    std::vector<number> values;
+    while(*p){
+        char* end;
+        values.push_back((number)strtoull(p, &end, 10));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.queries = 1000000;
+    opt.path = "snapshot.bin";
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--sizes=", 8) == 0){
+            opt.sizes = parse_list<size_t>(arg + 8);
+        }
+        else if(strncmp(arg, "--queries=", 10) == 0){
+            opt.queries = strtoull(arg + 10, nullptr, 10);
+        }
+        else if(strncmp(arg, "--path=", 7) == 0){
+            opt.path = arg + 7;
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.sizes.empty()){
+        opt.sizes = {1000000, 10000000};
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    printf("{\n  \"config\": {\"queries\": %zu, \"seed\": %llu},\n  \"results\": [", opt.queries, opt.seed);
+
+    for(size_t size : opt.sizes){
+        if(size > 0){
+            run_size(size, opt);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    std::remove(opt.path.c_str());
+    return 0;
+}
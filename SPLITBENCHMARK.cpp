@@ -0,0 +1,304 @@
+//Split and join on AVL with the heap and pool allocators, checked as well as timed
+//Builds a tree, then splits it at a random key and joins the halves back, over and over, and reports JSON.
+//Then splits halves off and drops them, to check their slots get used again
+//
+//Build and run:
+//    g++ -O2 -std=c++17 -pthread SPLITBENCHMARK.cpp -o splitbenchmark
+//    ./splitbenchmark > split.json
+//
+//Options:
+//    --sizes=200000,800000       Pairs in the tree, default is those
+//    --rounds=N                  Splits per tree in every workload, default 200
+//    --drop-size=N               Pairs in the tree for drop and slide, default 20000
+//    --seed=N                    Seed for keys and split points, default 12345
+//
+//Split only relinks and is O(log n) for both. Pool nodes can't move to another pool, so the returned tree's pool
+//shares the slabs instead, and join takes them back. copied_per_split counts nodes allocated by split, it should be 0.
+//After every split both halves are checked: sizes add up, every key is on the right side, and the split
+//allocated exactly as many nodes as it freed, counted over both trees. The first and last rounds also walk
+//every key in order and compare height() with a measured height. Any failure goes to stderr and exits with 1
+//
+//Workloads:
+//    split_join   splits at a random key and joins the halves back
+//    drop         splits off the upper half, destroys it, and inserts its keys again
+//    slide        keeps a window of keys, t = t.split(cutoff) drops the oldest quarter and newer keys are inserted
+//Under the pool, a dropped half's slots must go back to the tree that is left. heap_bytes_first and heap_bytes_last
+//are what malloc has handed out after the first and last round (glibc's mallinfo2, -1 without it), and the last
+//may be at most a quarter more than the first. A leak grows it by half the tree every round
+
+#include <iostream> //For size_t and other things
+#include <cstdio> //For printf
+#include <cstdlib> //For strtoull and exit
+#include <cstring> //For parsing options
+#include <vector> //For keys and split points
+#include <random> //For keys and split points
+#include <cstdint> //For counters
+#include <chrono> //For timing
+#include <algorithm> //For shuffling
+#include <malloc.h> //For mallinfo2
+#include "AVL.h"
+
+typedef int key_type;
+typedef int value_type;
+
+//RUNNER
+
+struct options{
+    std::vector<size_t> sizes;
+    size_t rounds;
+    size_t drop_size;
+    unsigned long long seed;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static bool first_result = true;
+
+static long long elapsed_ns(bench_clock::time_point start, bench_clock::time_point stop){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+}
+
+static long long heap_in_use(){
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    //Small blocks come from the arena, big ones (slabs, say) are mapped on their own
+    struct mallinfo2 info = mallinfo2();
+    return (long long)(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+static void fail(const char* alloc, size_t size, size_t round, const char* what){
+    fprintf(stderr, "%s pool, size %zu, round %zu: %s\n", alloc, size, round, what);
+    exit(1);
+}
+
+//Keys are 0 to size - 1, so each half must hold exactly the keys on its side of k
+template<typename tree_type>
+static void check_halves(const char* alloc, size_t size, size_t round, tree_type& less, tree_type& greater, key_type k, long long live_before, bool walk){
+    size_t expected_less = k < 0 ? 0 : std::min((size_t)k, size);
+    if(less.size() != expected_less || greater.size() != size - expected_less){
+        fail(alloc, size, round, "halves have the wrong sizes");
+    }
+
+    cop3530::tree_stats a = less.stats();
+    cop3530::tree_stats b = greater.stats();
+    long long live_after = (long long)(a.allocations + b.allocations) - (long long)(a.frees + b.frees);
+    if(live_after != live_before){
+        fail(alloc, size, round, "split allocated and freed a different number of nodes");
+    }
+
+    if(less.size() > 0 && less.select(less.size() - 1) >= k){
+        fail(alloc, size, round, "less half has a key not less than the split key");
+    }
+    if(greater.size() > 0 && greater.select(0) < k){
+        fail(alloc, size, round, "greater half has a key less than the split key");
+    }
+
+    if(!walk){
+        return;
+    }
+
+    key_type expected = 0;
+    tree_type* halves[] = {&less, &greater};
+    for(tree_type* half : halves){
+        for(typename tree_type::iterator it = half->begin(); it != half->end(); ++it){
+            if(it->key != expected || it->value != expected){
+                fail(alloc, size, round, "keys out of order or values moved");
+            }
+            expected++;
+        }
+        if(half->height() != (int)half->shape_report(0).levels - 1){
+            fail(alloc, size, round, "cached height doesn't match the measured one");
+        }
+    }
+}
+
+template<template<typename> class allocator>
+static void run_tree(const char* alloc, size_t size, const std::vector<key_type>& keys, const std::vector<key_type>& splits){
+    typedef cop3530::basic_AVL<key_type, value_type, cop3530::three_way_compare<key_type>, allocator, cop3530::count_stats> tree_type;
+
+    tree_type t;
+    for(key_type k : keys){
+        t.insert(k, k);
+    }
+
+    long long split_ns = 0;
+    long long join_ns = 0;
+    uint64_t copied = 0;
+
+    for(size_t round = 0; round < splits.size(); round++){
+        key_type k = splits[round];
+        cop3530::tree_stats before = t.stats();
+        long long live_before = (long long)before.allocations - (long long)before.frees;
+
+        bench_clock::time_point start = bench_clock::now();
+        tree_type greater = t.split(k);
+        split_ns += elapsed_ns(start, bench_clock::now());
+
+        copied += t.stats().allocations + greater.stats().allocations - before.allocations;
+        check_halves(alloc, size, round, t, greater, k, live_before, round == 0 || round + 1 == splits.size());
+
+        start = bench_clock::now();
+        t.join(std::move(greater));
+        join_ns += elapsed_ns(start, bench_clock::now());
+
+        if(t.size() != size){
+            fail(alloc, size, round, "join lost nodes");
+        }
+    }
+
+    size_t rounds = splits.size();
+    printf("%s\n    {\"structure\": \"AVL\", \"allocator\": \"%s\", \"workload\": \"split_join\", \"size\": %zu, \"rounds\": %zu, \"split_ns_per_op\": %.2f, \"join_ns_per_op\": %.2f, \"copied_per_split\": %.1f, \"checked\": true}",
+           first_result ? "" : ",", alloc, size, rounds, rounds ? (double)split_ns / rounds : 0.0, rounds ? (double)join_ns / rounds : 0.0, rounds ? (double)copied / rounds : 0.0);
+    first_result = false;
+    fflush(stdout);
+}
+
+//Every round drops a quarter or half of the tree and puts as many keys back, so memory should stay where round 0 left it
+template<template<typename> class allocator>
+static void run_drop(const char* alloc, const char* workload, size_t size, size_t rounds){
+    typedef cop3530::basic_AVL<key_type, value_type, cop3530::three_way_compare<key_type>, allocator> tree_type;
+
+    bool slide = strcmp(workload, "slide") == 0;
+    key_type step = slide ? (key_type)(size / 4) : (key_type)(size / 2);
+    long long heap_first = -1;
+    long long heap_last = -1;
+    long long ns = 0;
+
+    {
+        tree_type t;
+        for(size_t i = 0; i < size; i++){
+            t.insert((key_type)i, (key_type)i);
+        }
+
+        //Window is lo to lo + size - 1, drop always puts back the same keys so lo stays 0
+        key_type lo = 0;
+        for(size_t round = 0; round < rounds; round++){
+            bench_clock::time_point start = bench_clock::now();
+            if(slide){
+                t = t.split(lo + step);
+                for(key_type k = lo + (key_type)size; k < lo + (key_type)size + step; k++){
+                    t.insert(k, k);
+                }
+                lo += step;
+            }
+            else{
+                {
+                    tree_type upper = t.split((key_type)size - step);
+                }
+                for(key_type k = (key_type)size - step; k < (key_type)size; k++){
+                    t.insert(k, k);
+                }
+            }
+            ns += elapsed_ns(start, bench_clock::now());
+
+            if(t.size() != size || t.select(0) != lo){
+                fail(alloc, size, round, "tree lost or kept the wrong keys");
+            }
+
+            if(round == 0){
+                heap_first = heap_in_use();
+            }
+        }
+
+        heap_last = heap_in_use();
+    }
+
+    if(heap_first >= 0 && heap_last - heap_first > heap_first / 4){
+        fail(alloc, size, rounds, "dropped halves' memory wasn't used again");
+    }
+
+    printf("%s\n    {\"structure\": \"AVL\", \"allocator\": \"%s\", \"workload\": \"%s\", \"size\": %zu, \"rounds\": %zu, \"round_ns\": %.2f, \"heap_bytes_first\": %lld, \"heap_bytes_last\": %lld, \"checked\": true}",
+           first_result ? "" : ",", alloc, workload, size, rounds, rounds ? (double)ns / rounds : 0.0, heap_first, heap_last);
+    first_result = false;
+    fflush(stdout);
+}
+
+static void run_size(size_t size, const options& opt){
+    std::mt19937_64 gen(opt.seed + size);
+    std::vector<key_type> keys(size);
+    for(size_t i = 0; i < size; i++){
+        keys[i] = (key_type)i;
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    //Split points run a little past both ends so empty halves are covered too
+    std::vector<key_type> splits(opt.rounds);
+    for(size_t i = 0; i < opt.rounds; i++){
+        splits[i] = (key_type)(gen() % (size + 2)) - 1;
+    }
+
+    run_tree<cop3530::heap_allocator>("heap", size, keys, splits);
+    run_tree<cop3530::pool_allocator>("pool", size, keys, splits);
+}
+
+static std::vector<size_t> parse_list(const char* p){
+    std::vector<size_t> values;
+    while(*p){
+        char* end;
+        values.push_back((size_t)strtoull(p, &end, 10));
+        if(*end != ','){
+            break;
+        }
+        p = end + 1;
+    }
+    return values;
+}
+
+static options parse_options(int argc, char** argv){
+    options opt;
+    opt.rounds = 200;
+    opt.drop_size = 20000;
+    opt.seed = 12345;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--sizes=", 8) == 0){
+            opt.sizes = parse_list(arg + 8);
+        }
+        else if(strncmp(arg, "--rounds=", 9) == 0){
+            opt.rounds = strtoull(arg + 9, nullptr, 10);
+        }
+        else if(strncmp(arg, "--drop-size=", 12) == 0){
+            opt.drop_size = strtoull(arg + 12, nullptr, 10);
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0){
+            opt.seed = strtoull(arg + 7, nullptr, 10);
+        }
+        else{
+            fprintf(stderr, "Unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    if(opt.sizes.empty()){
+        opt.sizes = {200000, 800000};
+    }
+
+    return opt;
+}
+
+int main(int argc, char** argv){
+    options opt = parse_options(argc, argv);
+
+    printf("{\n  \"config\": {\"rounds\": %zu, \"drop_size\": %zu, \"seed\": %llu},\n  \"results\": [", opt.rounds, opt.drop_size, opt.seed);
+
+    for(size_t size : opt.sizes){
+        if(size > 0){
+            run_size(size, opt);
+        }
+    }
+
+    //Slide drops a quarter of the tree, which has to be at least one key
+    if(opt.drop_size >= 4){
+        const char* workloads[] = {"drop", "slide"};
+        for(const char* workload : workloads){
+            run_drop<cop3530::heap_allocator>("heap", workload, opt.drop_size, opt.rounds);
+            run_drop<cop3530::pool_allocator>("pool", workload, opt.drop_size, opt.rounds);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
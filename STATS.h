@@ -0,0 +1,136 @@
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <iostream> //For size_t and other things
+#include <cstdint> //For 64 bit counters
+
+namespace cop3530{
+
+    //Stats policies used by the trees. A tree holds one stats_policy and calls it at every comparison, rotation,
+    //lookup step, allocation and free. no_stats does nothing in every call, so with the default policy
+    //the calls are empty inline functions and compile away. count_stats keeps the numbers
+
+    //Counters handed back by a tree's stats(), every field stays 0 with no_stats
+    struct tree_stats{
+        uint64_t comparisons = 0; //Comparator calls, from every operation
+        uint64_t rotations_ll = 0; //Single right rotations fixing a left-left imbalance, and every right rotation of BSTROOT's splaying
+        uint64_t rotations_lr = 0; //Double rotations fixing a left-right imbalance, each counts once
+        uint64_t rotations_rr = 0; //Single left rotations fixing a right-right imbalance, and every left rotation of BSTROOT's splaying
+        uint64_t rotations_rl = 0; //Double rotations fixing a right-left imbalance, each counts once
+        uint64_t lookups = 0; //Keys searched by find, lookup, lookup_or, contains and the batch lookups
+        uint64_t visits = 0; //Nodes those searches looked at, visits / lookups is the average per lookup
+        uint64_t allocations = 0; //Nodes allocated
+        uint64_t frees = 0; //Nodes given back, one at a time or all at once by clear
+    };
+
+    //Default policy, nothing is counted and nothing is stored
+    class no_stats{
+
+    public:
+        static const bool enabled = false; //Trees can skip work that only feeds the counters
+
+        void compared(); //One comparator call
+        void rotated_ll(); //One rotation of each kind
+        void rotated_lr();
+        void rotated_rr();
+        void rotated_rl();
+        void looked_up(); //A lookup started
+        void visited(); //A lookup looked at one node
+        void allocated(); //One node allocated
+        void freed(size_t n = 1); //n nodes given back
+        tree_stats get() const; //Always all zero
+        void reset(); //Nothing to clear
+    };
+
+    //Counts everything in plain integers. A tree counting stats is no more thread safe than one that isn't,
+    //and AVL keeps its set operations on one thread so the counters are never shared
+    class count_stats{
+
+    private:
+        tree_stats counts;
+
+    public:
+        static const bool enabled = true;
+
+        void compared();
+        void rotated_ll();
+        void rotated_lr();
+        void rotated_rr();
+        void rotated_rl();
+        void looked_up();
+        void visited();
+        void allocated();
+        void freed(size_t n = 1);
+        tree_stats get() const; //Copy of the counters so far
+        void reset(); //Sets every counter back to 0
+    };
+
+    //NO STATS
+
+    inline void no_stats :: compared(){}
+    inline void no_stats :: rotated_ll(){}
+    inline void no_stats :: rotated_lr(){}
+    inline void no_stats :: rotated_rr(){}
+    inline void no_stats :: rotated_rl(){}
+    inline void no_stats :: looked_up(){}
+    inline void no_stats :: visited(){}
+    inline void no_stats :: allocated(){}
+    inline void no_stats :: freed(size_t){}
+
+    inline tree_stats no_stats :: get() const{
+        return tree_stats();
+    }
+
+    inline void no_stats :: reset(){
+        //Nothing was counted
+    }
+
+    //COUNT STATS
+
+    inline void count_stats :: compared(){
+        counts.comparisons++;
+    }
+
+    inline void count_stats :: rotated_ll(){
+        counts.rotations_ll++;
+    }
+
+    inline void count_stats :: rotated_lr(){
+        counts.rotations_lr++;
+    }
+
+    inline void count_stats :: rotated_rr(){
+        counts.rotations_rr++;
+    }
+
+    inline void count_stats :: rotated_rl(){
+        counts.rotations_rl++;
+    }
+
+    inline void count_stats :: looked_up(){
+        counts.lookups++;
+    }
+
+    inline void count_stats :: visited(){
+        counts.visits++;
+    }
+
+    inline void count_stats :: allocated(){
+        counts.allocations++;
+    }
+
+    inline void count_stats :: freed(size_t n){
+        counts.frees += n;
+    }
+
+    inline tree_stats count_stats :: get() const{
+        return counts;
+    }
+
+    inline void count_stats :: reset(){
+        counts = tree_stats();
+    }
+
+}
+
+#endif